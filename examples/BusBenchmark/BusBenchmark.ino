@@ -0,0 +1,105 @@
+// PCA9685-Arduino Bus Benchmark
+// In this example, we measure the i2c bus cost of the main channel and frequency APIs,
+// printing results as CSV so that they can be saved and compared across library changes.
+// Each row gives the bytes and START conditions actually put on the bus for a single
+// call, as counted by the library's performance counters, along with an estimate of the
+// time the bus spends on them, and the time measured for each call, which includes
+// processing overhead (and for setPWMFrequency, the 500us oscillator startup wait).
+// Requires PCA9685_ENABLE_PERF_COUNTERS to be defined (e.g. via -D build flag), and a
+// PCA9685 module to be connected. Rows are for this board's i2c buffer length only, so
+// to compare other buffer lengths, rebuild with the core's Wire buffer length changed
+// (BUFFER_LENGTH or I2C_BUFFER_LENGTH, see PCA9685.h) and run again.
+
+#include "PCA9685.h"
+
+#ifndef PCA9685_ENABLE_PERF_COUNTERS
+#error "BusBenchmark requires PCA9685_ENABLE_PERF_COUNTERS to be defined (e.g. via -D build flag), as byte and START counts come from the library's performance counters."
+#endif
+
+#define BENCHMARK_ITERATIONS            50
+
+const uint32_t i2cSpeeds[] = { 100000, 400000, 1000000 };
+
+enum BenchmarkAPI {
+    BenchmarkAPI_SetChannelPWM,         // setChannelPWM(0, ...)
+    BenchmarkAPI_SetChannelsPWM,        // setChannelsPWM(0, 16, ...)
+    BenchmarkAPI_SetAllChannelsPWM,     // setAllChannelsPWM(...)
+    BenchmarkAPI_GetChannelPWM,         // getChannelPWM(0)
+    BenchmarkAPI_GetChannelsPWM,        // getChannelsPWM(0, 16, ...)
+    BenchmarkAPI_SetPWMFrequency,       // setPWMFrequency(...), alternating so pre-scaler always changes
+
+    BenchmarkAPI_Count
+};
+
+const char *apiNames[] = {
+    "setChannelPWM", "setChannelsPWM16", "setAllChannelsPWM",
+    "getChannelPWM", "getChannelsPWM16", "setPWMFrequency"
+};
+
+uint16_t pwmAmounts[16];
+
+// Each byte takes 9 clocks (8 data bits + ACK), and each START/STOP pair about 2 more
+float estimateBusMicros(float bytes, float starts, uint32_t i2cSpeed) {
+    return ((bytes * 9 + starts * 2) * 1000000.0f) / i2cSpeed;
+}
+
+// Runs api BENCHMARK_ITERATIONS times, returning the average time per call and setting
+// the average bytes (including the i2c address byte sent after each START) and STARTs
+// per call, as counted by the library
+float measureMicros(PCA9685 &pwmController, int api, float *bytes, float *starts) {
+    uint16_t pwmAmountsRead[16];
+
+    pwmController.resetStats();
+    unsigned long beginMicros = micros();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; ++i) {
+        switch (api) {
+            case BenchmarkAPI_SetChannelPWM: pwmController.setChannelPWM(0, i * 64); break;
+            case BenchmarkAPI_SetChannelsPWM: pwmController.setChannelsPWM(0, 16, pwmAmounts); break;
+            case BenchmarkAPI_SetAllChannelsPWM: pwmController.setAllChannelsPWM(i * 64); break;
+            case BenchmarkAPI_GetChannelPWM: pwmController.getChannelPWM(0); break;
+            case BenchmarkAPI_GetChannelsPWM: pwmController.getChannelsPWM(0, 16, pwmAmountsRead); break;
+            case BenchmarkAPI_SetPWMFrequency: pwmController.setPWMFrequency(i & 1 ? 200 : 100); break;
+        }
+    }
+    float measuredMicros = (micros() - beginMicros) / (float)BENCHMARK_ITERATIONS;
+
+    const PCA9685_Stats &stats = pwmController.getStats();
+    uint32_t totalStarts = stats.transactions + stats.reads;
+    *starts = totalStarts / (float)BENCHMARK_ITERATIONS;
+    *bytes = (stats.bytesWritten + stats.bytesRead + totalStarts) / (float)BENCHMARK_ITERATIONS;
+
+    return measuredMicros;
+}
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    for (int i = 0; i < 16; ++i)
+        pwmAmounts[i] = i * 256;
+
+    Serial.println("api,bufferLength,i2cSpeed,bytes,starts,estimatedMicros,measuredMicros");
+
+    for (unsigned int speed = 0; speed < sizeof(i2cSpeeds) / sizeof(i2cSpeeds[0]); ++speed) {
+        PCA9685 pwmController(B000000, Wire, i2cSpeeds[speed]); // Library using default B000000 (A5-A0) i2c address, and default Wire @ benchmarked speed
+
+        pwmController.resetDevices();   // Resets all PCA9685 devices on i2c line, also setting i2c clock speed
+        pwmController.init();           // Initializes module using default totem-pole driver mode, and default disabled phase balancer
+
+        for (int api = 0; api < BenchmarkAPI_Count; ++api) {
+            float bytes, starts;
+            float measuredMicros = measureMicros(pwmController, api, &bytes, &starts);
+
+            Serial.print(apiNames[api]); Serial.print(",");
+            Serial.print(PCA9685_I2C_BUFFER_LENGTH); Serial.print(",");
+            Serial.print(i2cSpeeds[speed]); Serial.print(",");
+            Serial.print(bytes); Serial.print(",");
+            Serial.print(starts); Serial.print(",");
+            Serial.print(estimateBusMicros(bytes, starts, i2cSpeeds[speed])); Serial.print(",");
+            Serial.println(measuredMicros);
+        }
+    }
+}
+
+void loop() {
+}
@@ -0,0 +1,28 @@
+// PCA9685-Arduino Compile-Time Config Example
+// In this example, we use the compile-time configured controller template, which folds
+// modes into the code itself for smaller flash and RAM use on small boards.
+
+#include "PCA9685.h"
+
+// Open-drain driver mode, linear phase balancer, everything else defaulted
+typedef PCA9685_Config<PCA9685_OutputDriverMode_OpenDrain, PCA9685_PhaseBalancer_Linear> LEDConfig;
+
+PCA9685T<LEDConfig> pwmController;      // Library using default B000000 (A5-A0) i2c address, and default Wire @400kHz
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController.resetDevices();       // Resets all PCA9685 devices on i2c line
+
+    pwmController.init();               // Initializes module using modes from LEDConfig
+
+    pwmController.setPWMFrequency(500); // Set PWM freq to 500Hz (default is 200Hz, supports 24Hz to 1526Hz)
+
+    pwmController.setChannelPWM(0, 128 << 4); // Set PWM to 128/255, shifted into 4096-land, with channel bounds check folded away
+
+    Serial.println(pwmController.getChannelPWM(0)); // Should output 2048, which is 128 << 4
+}
+
+void loop() {
+}
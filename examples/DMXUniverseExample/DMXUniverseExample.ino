@@ -0,0 +1,57 @@
+// PCA9685-Arduino DMX Universe Example
+// In this example, we map a DMX512 universe onto two modules using a patch table, with
+// the first module driving gamma corrected 8-bit dimmers and the second module driving
+// 16-bit (coarse/fine slot pair) fixtures. Each update only writes out the channels that
+// actually changed since the last update, keeping bus load down between DMX frames.
+
+#include "PCA9685.h"
+
+// Fast-mode plus (1MHz) i2c is needed to hold 44Hz refresh for fully changing universes
+PCA9685 pwmController1(B000000, Wire, 1000000); // Library using B000000 (A5-A0) i2c address, and default Wire @1MHz
+PCA9685 pwmController2(B000001, Wire, 1000000); // Library using B000001 (A5-A0) i2c address, and default Wire @1MHz
+
+PCA9685 *pwmControllers[] = { &pwmController1, &pwmController2 };
+
+// Patch table: slot (DMX address - 1), controller index, channel, flags
+const PCA9685_DMXPatch patches[] PROGMEM = {
+    { 0, 0, 0, PCA9685_DMX_GAMMA }, { 1, 0, 1, PCA9685_DMX_GAMMA }, { 2, 0, 2, PCA9685_DMX_GAMMA }, { 3, 0, 3, PCA9685_DMX_GAMMA },
+    { 4, 0, 4, PCA9685_DMX_GAMMA }, { 5, 0, 5, PCA9685_DMX_GAMMA }, { 6, 0, 6, PCA9685_DMX_GAMMA }, { 7, 0, 7, PCA9685_DMX_GAMMA },
+    { 16, 1, 0, PCA9685_DMX_16BIT | PCA9685_DMX_GAMMA }, { 18, 1, 1, PCA9685_DMX_16BIT | PCA9685_DMX_GAMMA },
+    { 20, 1, 2, PCA9685_DMX_16BIT | PCA9685_DMX_GAMMA }, { 22, 1, 3, PCA9685_DMX_16BIT | PCA9685_DMX_GAMMA }
+};
+
+#define NUM_PATCHES                     (sizeof(patches) / sizeof(patches[0]))
+
+uint16_t lastAmounts[NUM_PATCHES];      // Last written PWM amount per patch, for finding changed channels
+
+PCA9685_DMXMapper dmxMapper(pwmControllers, 2, patches, NUM_PATCHES, lastAmounts, true);
+
+byte universe[PCA9685_DMX_UNIVERSE_LENGTH];
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController1.resetDevices();      // Resets all PCA9685 devices on i2c line
+
+    pwmController1.init();              // Initializes modules using default totem-pole driver mode, and default disabled phase balancer
+    pwmController2.init();
+
+    dmxMapper.invalidate();             // Forces first update to write out every patched channel
+}
+
+void loop() {
+    // Typically universe would be filled in by a DMX receiver, here we just fade through
+    static byte level = 0;
+    for (int slot = 0; slot < 8; ++slot)
+        universe[slot] = level + slot * 32;
+    universe[16] = level;               // Coarse slot, with fine slot left at 0
+
+    int numWritten = dmxMapper.update(universe);
+
+    Serial.print("Channels written: ");
+    Serial.println(numWritten);         // Unchanged channels (e.g. gamma corrected levels that round the same) are skipped
+
+    ++level;
+    delay(23);                          // ~44Hz refresh
+}
@@ -0,0 +1,35 @@
+// PCA9685-Arduino Dithering Example
+// In this example, we use the Ditherer class to slowly fade an LED in at very low
+// brightness levels, where the 4096/12-bit PWM range would otherwise show visible banding.
+
+#include "PCA9685.h"
+
+PCA9685 pwmController;                  // Library using default B000000 (A5-A0) i2c address, and default Wire @400kHz
+
+PCA9685_Ditherer pwmDitherer(pwmController); // Dithers all 16 channels of pwmController
+
+uint16_t fadeAmount = 0;
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController.resetDevices();       // Resets all PCA9685 devices on i2c line
+
+    pwmController.init(PCA9685_OutputDriverMode_OpenDrain); // Initializes module using open-drain driver mode, for direct LED connection
+
+    pwmController.setPWMFrequency(200); // Set PWM freq to 200Hz, which gives a 5ms PWM period
+}
+
+void loop() {
+    // Targets are 16-bit, so 16 dithered steps exist between each 12-bit PWM step
+    pwmDitherer.setChannelTarget(0, fadeAmount);
+    if (++fadeAmount > 2048) fadeAmount = 0; // Only fade over lowest 128 PWM steps
+
+    pwmDitherer.update();               // Writes out only channels that changed
+    delay(5);                           // Once per PWM period
+
+    // NOTE: The dithering scheduler must be updated once per PWM period for the output
+    // to remain stable. Slower update rates will still work, but will begin to show
+    // visible flicker at very low brightness levels.
+}
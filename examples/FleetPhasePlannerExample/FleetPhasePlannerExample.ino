@@ -0,0 +1,59 @@
+// PCA9685-Arduino Fleet Phase Planner Example
+// In this example, we balance the load of 48 LED channels spread over 3 modules that
+// share a single power supply, then print out the resulting peak current profile so that
+// the supply can be sized against it. For the planned phases to line up across modules,
+// the modules should share a common clock source (see enableExtClockLine). Requires
+// PCA9685_ENABLE_CHANNEL_CACHE to be defined (e.g. via -D build flag).
+
+#include "PCA9685.h"
+
+PCA9685 pwmController1(B000000);        // Library using B000000 (A5-A0) i2c address, and default Wire @400kHz
+PCA9685 pwmController2(B000001);        // Library using B000001 (A5-A0) i2c address, and default Wire @400kHz
+PCA9685 pwmController3(B000010);        // Library using B000010 (A5-A0) i2c address, and default Wire @400kHz
+
+PCA9685 *pwmControllers[] = { &pwmController1, &pwmController2, &pwmController3 };
+PCA9685_PhasePlanner phasePlanner(pwmControllers, 3);
+
+uint16_t pwmAmounts[48];                // Expected PWM amounts, module * 16 + channel
+float channelCurrents[48];              // On-state current of each channel, in mA
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController1.resetDevices();      // Resets all PCA9685 devices on i2c line
+
+    for (int i = 0; i < 3; ++i) {
+        pwmControllers[i]->init();      // Initializes module using default totem-pole driver mode, and default disabled phase balancer
+        pwmControllers[i]->setPWMFrequency(500); // Set PWM freq to 500Hz
+    }
+
+    for (int i = 0; i < 48; ++i) {
+        pwmAmounts[i] = 1024 + i * 32;  // Some fairly bright LEDs
+        channelCurrents[i] = 20;        // Each drawing 20mA when on
+    }
+
+    // Without any phase balancing, every channel turns on at the same time
+    for (int i = 0; i < 3; ++i)
+        pwmControllers[i]->setChannelsPWM(0, 16, &pwmAmounts[i * 16]);
+    Serial.print("Unbalanced peak current (mA): ");
+    Serial.println(phasePlanner.getCurrentProfile(NULL, 64, channelCurrents)); // Should output 960
+
+    // Packing each channel's on-time end-to-end brings the peak down to the minimum
+    phasePlanner.planPacked(pwmAmounts);
+    for (int i = 0; i < 3; ++i)
+        pwmControllers[i]->setChannelsPWM(0, 16, &pwmAmounts[i * 16]);
+
+    float peakCurrents[16];
+    Serial.print("Packed peak current (mA): ");
+    Serial.println(phasePlanner.getCurrentProfile(peakCurrents, 16, channelCurrents)); // Should output 420
+
+    Serial.println("Peak current profile (mA):");
+    for (int bin = 0; bin < 16; ++bin) {
+        Serial.print(bin * 256); Serial.print("-"); Serial.print(bin * 256 + 255);
+        Serial.print(": "); Serial.println(peakCurrents[bin]);
+    }
+}
+
+void loop() {
+}
@@ -0,0 +1,53 @@
+// PCA9685-Arduino Frame Buffer Service Example
+// In this example, for Linux hosts running an Arduino-compatible core, we run the shared
+// memory frame buffer service over two modules, letting any other process on the host
+// set channels without opening the i2c line itself. Requires PCA9685_ENABLE_FRAME_BUFFER_SERVICE
+// to be defined (e.g. via -D build flag), and linking with -pthread (and -lrt on older
+// glibc). Other processes only need to attach a PCA9685_FrameBufferClient, such as:
+//
+//   PCA9685_FrameBufferClient client;
+//   if (client.attach()) {
+//       int slab = client.getSlabIndex(B000001);
+//       client.setChannelPWM(slab, 0, 2048);   // Only stores into frame buffer
+//   }
+
+#include "PCA9685.h"
+
+PCA9685 pwmController1(B000000);        // Library using B000000 (A5-A0) i2c address, and default Wire @400kHz
+PCA9685 pwmController2(B000001);        // Library using B000001 (A5-A0) i2c address, and default Wire @400kHz
+
+PCA9685 *pwmControllers[] = { &pwmController1, &pwmController2 };
+PCA9685_FrameBufferService frameBufferService(pwmControllers, 2);
+PCA9685_FrameBufferClient frameBufferClient;
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController1.resetDevices();      // Resets all PCA9685 devices on i2c line
+
+    pwmController1.init();              // Initializes modules using default totem-pole driver mode, and default disabled phase balancer
+    pwmController2.init();
+
+    // Creates frame buffer at /dev/shm/pca9685, with bus thread flushing it at 100Hz. From
+    // here on, only the bus thread may use the controllers.
+    if (!frameBufferService.begin(100)) {
+        Serial.println("Frame buffer service failed to begin");
+        return;
+    }
+
+    frameBufferClient.attach();         // Attaches as a client would from another process
+}
+
+void loop() {
+    static uint16_t pwmAmount = 0;
+    frameBufferClient.setChannelPWM(1, 0, pwmAmount); // Second module (slab 1), channel 0
+    pwmAmount = (pwmAmount + 64) % 4096;
+
+    Serial.print("Frames flushed: ");
+    Serial.print(frameBufferService.getFramesFlushed());
+    Serial.print(", overruns: ");
+    Serial.println(frameBufferService.getFrameOverruns());
+
+    delay(100);
+}
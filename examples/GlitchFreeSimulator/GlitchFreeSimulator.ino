@@ -0,0 +1,196 @@
+// PCA9685-Arduino Glitch-Free Simulator
+// In this example, we check glitch-free channel updates (see enableGlitchFreeUpdates)
+// by simulating the module's PWM counter. For each PWM change, the channel's phase
+// edges are read back from the module before and after the update, and then the
+// output is simulated cycle by cycle with the update landing at every one of the 4096
+// counter positions. Any runt pulse (shorter than both the old and new high or low
+// phase), stretched pulse (longer than both), or skipped/doubled cycle is counted as a
+// glitch. Cases cover lengthening and shortening, pulses wrapping around the end of the
+// counter, and full on/off transitions, and are run both without and with glitch-free
+// updates enabled. Requires PCA9685_ENABLE_CHANNEL_CACHE to be defined (e.g. via -D build
+// flag), and a PCA9685 module to be connected.
+
+#include "PCA9685.h"
+
+PCA9685 pwmController(B000000);         // Library using default B000000 (A5-A0) i2c address, and default Wire @400kHz
+
+#define SIMULATED_CHANNEL               0
+#define LED0_ON_L_REG                   (byte)0x06  // First channel register, from datasheet
+#define PHASE_FULL                      (uint16_t)0x1000
+#define CYCLE_LENGTH                    4096L
+#define NO_LIMIT                        (CYCLE_LENGTH * 5)
+
+struct GlitchCase {
+    const char *name;                   // Case name
+    uint16_t phaseOffset;               // Channel phase offset, see setChannelPhaseOffset
+    uint16_t pwmAmounts[4];             // PWM amounts to step through
+    int numAmounts;                     // Number of PWM amounts
+};
+
+const GlitchCase glitchCases[] = {
+    { "lengthen",               0,    { 1000, 3000 }, 2 },
+    { "shorten",                0,    { 3000, 1000 }, 2 },
+    { "lengthen wrapped",       3500, { 1000, 3000 }, 2 },
+    { "shorten wrapped",        3500, { 3000, 1000 }, 2 },
+    { "lengthen across end",    3000, { 500, 2000 }, 2 },
+    { "shorten across end",     3000, { 2000, 500 }, 2 },
+    { "drift across end",       2048, { 3000, 100, 4000, 50 }, 4 },
+    { "from full off",          1000, { 0, 2000 }, 2 },
+    { "from full on",           1000, { 4096, 2000 }, 2 },
+    { "to full off",            1000, { 2000, 0 }, 2 },
+    { "to full on",             1000, { 2000, 4096 }, 2 },
+};
+
+// Reads channel's raw phase edges back from module
+void readPhaseEdges(uint16_t *phaseBegin, uint16_t *phaseEnd) {
+    Wire.beginTransmission(pwmController.getI2CAddress());
+    Wire.write(LED0_ON_L_REG + (SIMULATED_CHANNEL << 2));
+    Wire.endTransmission();
+    Wire.requestFrom(pwmController.getI2CAddress(), (uint8_t)4);
+    *phaseBegin = Wire.read(); *phaseBegin |= Wire.read() << 8;
+    *phaseEnd = Wire.read(); *phaseEnd |= Wire.read() << 8;
+}
+
+// Output level after counter reaches given position, as per datasheet section 7.3.3
+bool simulateOutput(bool level, uint16_t counter, uint16_t phaseBegin, uint16_t phaseEnd) {
+    if (phaseEnd & PHASE_FULL) return false; // Full off takes precedence over full on
+    if (phaseBegin & PHASE_FULL) return true;
+    if (counter == (phaseBegin & 0x0FFF)) level = true;
+    if (counter == (phaseEnd & 0x0FFF)) level = false;
+    return level;
+}
+
+// Returns allowed [minimum, maximum] length of a phase going from old to new length,
+// where from a zero-length phase the new one must come out whole, to a zero-length
+// phase the old one may be cut short, and a whole-cycle phase may run any length.
+void allowedLength(long oldLength, long newLength, long *minLength, long *maxLength) {
+    *minLength = !oldLength ? newLength : (!newLength ? 0 : min(oldLength, newLength));
+    *maxLength = oldLength == CYCLE_LENGTH || newLength == CYCLE_LENGTH ? NO_LIMIT : max(oldLength, newLength);
+}
+
+// Adds time to sorted event times, skipping duplicates
+void addEventTime(long *times, int *numTimes, long time) {
+    int index = 0;
+    while (index < *numTimes && times[index] < time) ++index;
+    if (index < *numTimes && times[index] == time) return;
+
+    for (int moveIndex = *numTimes; moveIndex > index; --moveIndex)
+        times[moveIndex] = times[moveIndex - 1];
+    times[index] = time;
+    ++*numTimes;
+}
+
+// Simulates update from old to new phase edges landing at every counter position, one
+// settling cycle and one measured cycle with old edges, then the update cycle, then two
+// measured cycles with new edges,
+// returning number of update positions that glitched. Output only changes as counter
+// passes an edge (or as the update lands), so only those times are stepped through.
+int simulateUpdate(uint16_t oldAmount, uint16_t oldBegin, uint16_t oldEnd,
+                   uint16_t newAmount, uint16_t newBegin, uint16_t newEnd) {
+    long highMin, highMax, lowMin, lowMax;
+    allowedLength(oldAmount, newAmount, &highMin, &highMax);
+    allowedLength(CYCLE_LENGTH - oldAmount, CYCLE_LENGTH - newAmount, &lowMin, &lowMax);
+
+    // Rising edges of consecutive cycles may only be as far apart as the edges moved
+    bool checkCycles = oldAmount > 0 && oldAmount < PHASE_FULL && newAmount > 0 && newAmount < PHASE_FULL;
+    long cycleSlack = abs((int)newAmount - (int)oldAmount);
+
+    int glitches = 0;
+    for (long updateAt = CYCLE_LENGTH * 2; updateAt < CYCLE_LENGTH * 3; ++updateAt) {
+        long times[22];
+        int numTimes = 0;
+        addEventTime(times, &numTimes, 0);
+        addEventTime(times, &numTimes, updateAt);
+        for (long cycle = 0; cycle < CYCLE_LENGTH * 5; cycle += CYCLE_LENGTH) {
+            addEventTime(times, &numTimes, cycle + (oldBegin & 0x0FFF));
+            addEventTime(times, &numTimes, cycle + (oldEnd & 0x0FFF));
+            addEventTime(times, &numTimes, cycle + (newBegin & 0x0FFF));
+            addEventTime(times, &numTimes, cycle + (newEnd & 0x0FFF));
+        }
+
+        bool level = false;
+        long lastRise = -1, lastFall = -1;
+        bool glitched = false;
+
+        for (int index = 0; index < numTimes && !glitched; ++index) {
+            long time = times[index];
+            bool updated = time >= updateAt;
+            bool nextLevel = simulateOutput(level, (uint16_t)(time % CYCLE_LENGTH),
+                                            updated ? newBegin : oldBegin, updated ? newEnd : oldEnd);
+
+            if (time >= CYCLE_LENGTH && nextLevel != level) {
+                if (nextLevel) {
+                    if (lastFall >= 0 && (time - lastFall < lowMin || time - lastFall > lowMax)) glitched = true;
+                    if (checkCycles && lastRise >= 0 && abs(time - lastRise - CYCLE_LENGTH) > cycleSlack) glitched = true;
+                    lastRise = time;
+                }
+                else {
+                    if (lastRise >= 0 && (time - lastRise < highMin || time - lastRise > highMax)) glitched = true;
+                    lastFall = time;
+                }
+            }
+            level = nextLevel;
+        }
+
+        if (glitched) ++glitches;
+    }
+    return glitches;
+}
+
+int simulateCase(const GlitchCase &glitchCase) {
+    uint16_t oldBegin, oldEnd, newBegin, newEnd;
+    int glitches = 0;
+
+    pwmController.setChannelOff(SIMULATED_CHANNEL);
+    pwmController.setChannelPhaseOffset(SIMULATED_CHANNEL, glitchCase.phaseOffset);
+    pwmController.setChannelPWM(SIMULATED_CHANNEL, glitchCase.pwmAmounts[0]);
+    readPhaseEdges(&oldBegin, &oldEnd);
+
+    for (int index = 1; index < glitchCase.numAmounts; ++index) {
+        pwmController.setChannelPWM(SIMULATED_CHANNEL, glitchCase.pwmAmounts[index]);
+        readPhaseEdges(&newBegin, &newEnd);
+
+        glitches += simulateUpdate(glitchCase.pwmAmounts[index - 1], oldBegin, oldEnd,
+                                   glitchCase.pwmAmounts[index], newBegin, newEnd);
+
+        oldBegin = newBegin; oldEnd = newEnd;
+    }
+    return glitches;
+}
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController.resetDevices();       // Resets all PCA9685 devices on i2c line
+
+    pwmController.init();               // Initializes module using default totem-pole driver mode, and default disabled phase balancer
+
+    Serial.println("case,glitchesWithout,glitchesWith");
+
+    int totalWithout = 0, totalWith = 0;
+    for (unsigned int index = 0; index < sizeof(glitchCases) / sizeof(glitchCases[0]); ++index) {
+        pwmController.disableGlitchFreeUpdates();
+        int glitchesWithout = simulateCase(glitchCases[index]);
+        pwmController.enableGlitchFreeUpdates();
+        int glitchesWith = simulateCase(glitchCases[index]);
+
+        Serial.print(glitchCases[index].name); Serial.print(",");
+        Serial.print(glitchesWithout); Serial.print(",");
+        Serial.println(glitchesWith);
+
+        totalWithout += glitchesWithout;
+        totalWith += glitchesWith;
+    }
+
+    Serial.print("Update positions glitched without glitch-free updates: ");
+    Serial.print(totalWithout);
+    Serial.print(", with: ");
+    Serial.println(totalWith);
+    Serial.println(totalWith ? "FAIL" : "PASS");
+
+    pwmController.setChannelOff(SIMULATED_CHANNEL);
+}
+
+void loop() {
+}
@@ -0,0 +1,51 @@
+// PCA9685-Arduino Recorder Example
+// In this example, we record a few seconds of channel writes into a RAM buffer using the
+// library's delta-compressed recording format, then play the recording back at 4x speed.
+// Requires PCA9685_ENABLE_RECORDER to be defined (e.g. via -D build flag). Recordings
+// may also be made straight into an SD card File (or any other Print), and played back
+// from one (or any other Stream), for captures running hours long.
+
+#include "PCA9685.h"
+
+PCA9685 pwmController(B000000);         // Library using default B000000 (A5-A0) i2c address, and default Wire @400kHz
+
+PCA9685 *pwmControllers[] = { &pwmController };
+
+byte recording[1024];                   // Typically 2-3 bytes per channel write
+PCA9685_RecordBuffer recordBuffer(recording, sizeof(recording));
+PCA9685_Recorder recorder;
+PCA9685_Player player(pwmControllers, 1);
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController.resetDevices();       // Resets all PCA9685 devices on i2c line
+
+    pwmController.init();               // Initializes module using default totem-pole driver mode, and default disabled phase balancer
+
+    recorder.begin(recordBuffer);       // From here on, every write to any module gets recorded
+
+    uint16_t pwms[4];
+    for (int step = 0; step < 64 && recorder.isRecording(); ++step) {
+        for (int channel = 0; channel < 4; ++channel)
+            pwms[channel] = (uint16_t)(step * 64 + channel * 8);
+        pwmController.setChannelsPWM(0, 4, pwms);
+        delay(30);
+    }
+
+    recorder.end();
+
+    Serial.print("Recorded bytes: ");
+    Serial.println(recorder.getBytesRecorded());
+
+    recordBuffer.rewind();              // Plays back from start of buffer
+    player.begin(recordBuffer, 4.0f);   // 4x faster than recorded
+}
+
+void loop() {
+    if (player.isPlaying() && !player.update()) {
+        Serial.print("Records played: ");
+        Serial.println(player.getRecordsPlayed());
+    }
+}
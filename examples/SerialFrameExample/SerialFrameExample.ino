@@ -0,0 +1,36 @@
+// PCA9685-Arduino Serial Frame Example
+// In this example, we stream channel data sent from a PC over USB serial into two
+// modules, using the library's compact binary frame protocol (see PCA9685_FrameParser
+// for the frame layout). Frames are decoded as bytes arrive, and each is only written
+// out to its module once its CRC checks out.
+
+#include "PCA9685.h"
+
+PCA9685 pwmController1(B000000);        // Library using B000000 (A5-A0) i2c address, and default Wire @400kHz
+PCA9685 pwmController2(B000001);        // Library using B000001 (A5-A0) i2c address, and default Wire @400kHz
+
+PCA9685 *pwmControllers[] = { &pwmController1, &pwmController2 };
+PCA9685_FrameParser frameParser(pwmControllers, 2);
+
+void setup() {
+    Serial.begin(1000000);              // Begin Serial and Wire interfaces, with Serial fast enough to keep i2c busy
+    Wire.begin();
+
+    pwmController1.resetDevices();      // Resets all PCA9685 devices on i2c line
+
+    pwmController1.init();              // Initializes modules using default totem-pole driver mode, and default disabled phase balancer
+    pwmController2.init();
+
+    // As a self-test, feed in a frame setting channels 0-3 of the second module
+    byte frame[PCA9685_FRAME_MAX_LENGTH];
+    uint16_t pwmAmounts[4] = { 0, 1024, 2048, 4096 };
+    int frameLength = PCA9685_FrameParser::encodeFrame(frame, B000001, 0, 4, pwmAmounts);
+    for (int i = 0; i < frameLength; ++i)
+        frameParser.feed(frame[i]);
+
+    Serial.println(pwmController2.getChannelPWM(2)); // Should output 2048
+}
+
+void loop() {
+    frameParser.feed(Serial);           // Decodes whatever has arrived, committing each completed frame
+}
@@ -0,0 +1,53 @@
+// PCA9685-Arduino Servo Evaluator Benchmark
+// In this example, we measure how many processor cycles it takes to evaluate servo PWM
+// values across the entire -90° to +90° range, comparing the floating-point and the
+// fixed-point (Q8) evaluation paths for both linear and cubic spline servo evaluators.
+// No PCA9685 module needs to be connected to run this benchmark.
+
+#include "PCA9685.h"
+
+PCA9685_ServoEval pwmServoLinear;               // Linear, default 102/512 for -90°/+90°
+PCA9685_ServoEval pwmServoCSpline(128,324,526); // Cubic spline, 128/324/526 for -90°/0°/+90°
+
+volatile uint16_t pwmSink;              // Keeps compiler from optimizing evaluation away
+
+// Evaluates every 1/4th of a degree from -90° to +90°
+#define BENCHMARK_CALLS                 721
+
+float cyclesPerCall(unsigned long elapsedMicros) {
+    return (elapsedMicros * (F_CPU / 1000000.0f)) / BENCHMARK_CALLS;
+}
+
+void benchmarkServoEval(const char *name, PCA9685_ServoEval &pwmServo) {
+    unsigned long beginMicros = micros();
+    for (int angleQ2 = -90 * 4; angleQ2 <= 90 * 4; ++angleQ2) {
+        pwmSink = pwmServo.pwmForAngle(angleQ2 * 0.25f);
+    }
+    unsigned long floatMicros = micros() - beginMicros;
+
+    beginMicros = micros();
+    for (int angleQ2 = -90 * 4; angleQ2 <= 90 * 4; ++angleQ2) {
+        pwmSink = pwmServo.pwmForAngleQ8(angleQ2 * 64);
+    }
+    unsigned long fixedMicros = micros() - beginMicros;
+
+    Serial.print(name);
+    Serial.print(": float: ");
+    Serial.print(cyclesPerCall(floatMicros));
+    Serial.print(" cycles/call, fixed: ");
+    Serial.print(cyclesPerCall(fixedMicros));
+    Serial.println(" cycles/call");
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    benchmarkServoEval("Linear", pwmServoLinear);
+    benchmarkServoEval("CSpline", pwmServoCSpline);
+
+    // NOTE: Timings include loop overhead and are only as accurate as micros() on your
+    // board (4us resolution on 16MHz AVR), which is why many calls are averaged over.
+}
+
+void loop() {
+}
@@ -17,6 +17,16 @@ PCA9685_ServoEval pwmServo1;
 // range while slightly more in the 0° to +90° range.
 PCA9685_ServoEval pwmServo2(128,324,526);
 
+// Our third servo is cheap and quite nonlinear, so it has been calibrated at 5 evenly
+// spaced points (-90°, -45°, 0°, +45°, and +90°) instead. Boards with very limited RAM
+// (e.g. AVR) will need PCA9685_SERVOEVAL_MAX_POINTS defined to 5 or more to allow this.
+const uint16_t pwmServo3Points[] = { 120, 200, 330, 430, 530 };
+PCA9685_ServoEval pwmServo3(pwmServo3Points);
+
+// Samples pwmServo2 at every integer degree into a 181 entry lookup table, which makes
+// each lookup a constant-time table read plus linear interpolation between entries.
+PCA9685_ServoEvalLUT<256> pwmServo2LUT(pwmServo2);
+
 void setup() {
     Serial.begin(115200);               // Begin Serial and Wire1 interfaces
     Wire1.begin();
@@ -50,6 +60,13 @@ void setup() {
 
     pwmController.setChannelPWM(1, pwmServo2.pwmForAngle(90));
     Serial.println(pwmController.getChannelPWM(1)); // Should output 526 for +90°
+
+    // Passes exactly through each of its calibration points
+    Serial.println(pwmServo3.pwmForAngle(-45)); // Should output 200 for -45°
+    Serial.println(pwmServo3.pwmForAngle(45));  // Should output 430 for +45°
+
+    // Lookup table gives same results as evaluator it was sampled from
+    Serial.println(pwmServo2LUT.pwmForAngle(45)); // Should output 424 for +45°
 }
 
 void loop() {
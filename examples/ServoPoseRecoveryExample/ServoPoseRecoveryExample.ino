@@ -0,0 +1,65 @@
+// PCA9685-Arduino Servo Pose Recovery Example
+// In this example, we recover the positions of 6 servos from the PCA9685's channel
+// registers after the microcontroller restarts, so that motion can resume from where it
+// left off instead of re-homing every servo (which would cause them to jump violently).
+// Note that resetDevices() is not called here, as doing so would clear those registers.
+
+#include "PCA9685.h"
+
+PCA9685 pwmController;                  // Library using default B000000 (A5-A0) i2c address, and default Wire @400kHz
+
+PCA9685_ServoEval pwmServo(128,324,526); // Same calibration as used to originally write the channels
+
+const int numServos = 6;
+float servoAngles[numServos];           // Current servo angles, -90° to +90°
+float servoTargets[numServos];          // Target servo angles, -90° to +90°
+
+void setup() {
+    Serial.begin(115200);               // Begin Serial and Wire interfaces
+    Wire.begin();
+
+    pwmController.init();               // Initializes module using default totem-pole driver mode, and default disabled phase balancer
+
+    pwmController.setPWMFreqServo();    // 50Hz provides standard 20ms servo phase length
+
+    // Reads back all servo channels at once, which takes a single i2c transaction pair
+    uint16_t pwms[numServos];
+    pwmController.getChannelsPWM(0, numServos, pwms);
+
+    for (int i = 0; i < numServos; ++i) {
+        if (pwms[i] == 0) {
+            // Channel is full off (e.g. module itself was power cycled) or failed to read back, so home it
+            servoAngles[i] = 0;
+            pwmController.setChannelPWM(i, pwmServo.pwmForAngle(0));
+        }
+        else {
+            servoAngles[i] = pwmServo.angleForPwm(pwms[i]);
+        }
+
+        servoTargets[i] = servoAngles[i];
+
+        Serial.print("Servo "); Serial.print(i);
+        Serial.print(" PWM: "); Serial.print(pwms[i]);
+        Serial.print(", angle: "); Serial.println(servoAngles[i]);
+    }
+
+    randomSeed(analogRead(0));
+}
+
+void loop() {
+    uint16_t pwms[numServos];
+
+    // Slews each servo towards its target by at most 1° per update, picking a new
+    // random target whenever one is reached
+    for (int i = 0; i < numServos; ++i) {
+        if (servoAngles[i] == servoTargets[i])
+            servoTargets[i] = random(-90, 91);
+
+        servoAngles[i] += constrain(servoTargets[i] - servoAngles[i], -1.0f, 1.0f);
+        pwms[i] = pwmServo.pwmForAngle(servoAngles[i]);
+    }
+
+    pwmController.setChannelsPWM(0, numServos, pwms);
+
+    delay(20);
+}
@@ -6,49 +6,60 @@
 
 #include "PCA9685.h"
 #include <assert.h>
+#ifdef PCA9685_USE_FRAME_BUFFER_SERVICE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
-#define PCA9685_I2C_BASE_MODULE_ADDRESS (byte)0x40
-#define PCA9685_I2C_BASE_MODULE_ADRMASK (byte)0x3F
+// Module base i2c addresses
+#define PCA9685_I2C_BASE_MODULE_ADDRESS PCA9685_Detail::I2C_BASE_MODULE_ADDRESS
+#define PCA9685_I2C_BASE_MODULE_ADRMASK PCA9685_Detail::I2C_BASE_MODULE_ADRMASK
 #define PCA9685_I2C_BASE_PROXY_ADDRESS  (byte)0xE0
 #define PCA9685_I2C_BASE_PROXY_ADRMASK  (byte)0xFE
 
 // Register addresses from data sheet
-#define PCA9685_MODE1_REG               (byte)0x00
-#define PCA9685_MODE2_REG               (byte)0x01
+#define PCA9685_MODE1_REG               PCA9685_Detail::MODE1_REG
+#define PCA9685_MODE2_REG               PCA9685_Detail::MODE2_REG
 #define PCA9685_SUBADR1_REG             (byte)0x02
 #define PCA9685_SUBADR2_REG             (byte)0x03
 #define PCA9685_SUBADR3_REG             (byte)0x04
 #define PCA9685_ALLCALL_REG             (byte)0x05
-#define PCA9685_LED0_REG                (byte)0x06          // Start of LEDx regs, 4B per reg, 2B on phase, 2B off phase, little-endian
-#define PCA9685_PRESCALE_REG            (byte)0xFE
-#define PCA9685_ALLLED_REG              (byte)0xFA
+#define PCA9685_LED0_REG                PCA9685_Detail::LED0_REG
+#define PCA9685_PRESCALE_REG            PCA9685_Detail::PRESCALE_REG
+#define PCA9685_ALLLED_REG              PCA9685_Detail::ALLLED_REG
 
 // Mode1 register values
-#define PCA9685_MODE1_RESTART           (byte)0x80
+#define PCA9685_MODE1_RESTART           PCA9685_Detail::MODE1_RESTART
 #define PCA9685_MODE1_EXTCLK            (byte)0x40
-#define PCA9685_MODE1_AUTOINC           (byte)0x20
-#define PCA9685_MODE1_SLEEP             (byte)0x10
+#define PCA9685_MODE1_AUTOINC           PCA9685_Detail::MODE1_AUTOINC
+#define PCA9685_MODE1_SLEEP             PCA9685_Detail::MODE1_SLEEP
 #define PCA9685_MODE1_SUBADR1           (byte)0x08
 #define PCA9685_MODE1_SUBADR2           (byte)0x04
 #define PCA9685_MODE1_SUBADR3           (byte)0x02
 #define PCA9685_MODE1_ALLCALL           (byte)0x01
 
 // Mode2 register values
-#define PCA9685_MODE2_OUTDRV_TPOLE      (byte)0x04
-#define PCA9685_MODE2_INVRT             (byte)0x10
-#define PCA9685_MODE2_OUTNE_TPHIGH      (byte)0x01
-#define PCA9685_MODE2_OUTNE_HIGHZ       (byte)0x02
-#define PCA9685_MODE2_OCH_ONACK         (byte)0x08
+#define PCA9685_MODE2_OUTDRV_TPOLE      PCA9685_Detail::MODE2_OUTDRV_TPOLE
+#define PCA9685_MODE2_INVRT             PCA9685_Detail::MODE2_INVRT
+#define PCA9685_MODE2_OUTNE_TPHIGH      PCA9685_Detail::MODE2_OUTNE_TPHIGH
+#define PCA9685_MODE2_OUTNE_HIGHZ       PCA9685_Detail::MODE2_OUTNE_HIGHZ
+#define PCA9685_MODE2_OCH_ONACK         PCA9685_Detail::MODE2_OCH_ONACK
 
-#define PCA9685_SW_RESET                (byte)0x06          // Sent to address 0x00 to reset all devices on Wire line
-#define PCA9685_PWM_FULL                (uint16_t)0x1000    // Special value for full on/full off LEDx modes
-#define PCA9685_PWM_MASK                (uint16_t)0x0FFF    // Mask for 12-bit/4096 possible phase positions
+#define PCA9685_OSC_FREQUENCY           (uint32_t)25000000  // Nominal internal oscillator frequency
+#define PCA9685_SW_RESET                PCA9685_Detail::SW_RESET
+#define PCA9685_PWM_FULL                PCA9685_Detail::PWM_FULL
+#define PCA9685_PWM_MASK                PCA9685_Detail::PWM_MASK
 
 #define PCA9685_CHANNEL_COUNT           16
 #define PCA9685_MIN_CHANNEL             0
 #define PCA9685_MAX_CHANNEL             (PCA9685_CHANNEL_COUNT - 1)
-#define PCA9685_ALLLED_CHANNEL          -1                  // Special value for ALLLED registers
-
+#define PCA9685_ALLLED_CHANNEL          PCA9685_Detail::ALLLED_CHANNEL
 
 #ifdef PCA9685_USE_SOFTWARE_I2C
 boolean __attribute__((noinline)) i2c_init(void);
@@ -64,47 +75,103 @@ PCA9685::PCA9685(byte i2cAddress, TwoWire& i2cWire, uint32_t i2cSpeed)
     // I2C 7-bit address is B 1 A5 A4 A3 A2 A1 A0
     // RW lsb bit added by Arduino core TWI library
     : _i2cAddress(i2cAddress),
-      _i2cWire(&i2cWire),
-      _i2cSpeed(i2cSpeed),
-      _driverMode(PCA9685_OutputDriverMode_Undefined),
-      _enabledMode(PCA9685_OutputEnabledMode_Undefined),
-      _disabledMode(PCA9685_OutputDisabledMode_Undefined),
-      _updateMode(PCA9685_ChannelUpdateMode_Undefined),
-      _phaseBalancer(PCA9685_PhaseBalancer_Undefined),
+      _bus(PCA9685_Bus::getSharedBus(i2cWire, i2cSpeed)),
+      _driverMode(0), _enabledMode(0), _disabledMode(0), _updateMode(0), _phaseBalancer(0),
+      _isInitialized(false),
       _isProxyAddresser(false),
-      _lastI2CError(0)
-{ }
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      _phaseBeginsDirty(false),
+      _glitchFreeUpdates(false),
+#endif
+      _oscFrequency(PCA9685_OSC_FREQUENCY),
+      _preScalerVal(0),
+      _lastI2CError(_bus ? 0 : 4)
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      , _phaseOffsets()
+#endif
+{
+    resetChannelCache();
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    resetStats();
+#endif
+}
 
 PCA9685::PCA9685(TwoWire& i2cWire, uint32_t i2cSpeed, byte i2cAddress)
     : _i2cAddress(i2cAddress),
-      _i2cWire(&i2cWire),
-      _i2cSpeed(i2cSpeed),
-      _driverMode(PCA9685_OutputDriverMode_Undefined),
-      _enabledMode(PCA9685_OutputEnabledMode_Undefined),
-      _disabledMode(PCA9685_OutputDisabledMode_Undefined),
-      _updateMode(PCA9685_ChannelUpdateMode_Undefined),
-      _phaseBalancer(PCA9685_PhaseBalancer_Undefined),
+      _bus(PCA9685_Bus::getSharedBus(i2cWire, i2cSpeed)),
+      _driverMode(0), _enabledMode(0), _disabledMode(0), _updateMode(0), _phaseBalancer(0),
+      _isInitialized(false),
       _isProxyAddresser(false),
-      _lastI2CError(0)
-{ }
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      _phaseBeginsDirty(false),
+      _glitchFreeUpdates(false),
+#endif
+      _oscFrequency(PCA9685_OSC_FREQUENCY),
+      _preScalerVal(0),
+      _lastI2CError(_bus ? 0 : 4)
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      , _phaseOffsets()
+#endif
+{
+    resetChannelCache();
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    resetStats();
+#endif
+}
+
+PCA9685::PCA9685(PCA9685_Bus& bus, byte i2cAddress)
+    : _i2cAddress(i2cAddress),
+      _bus(&bus),
+      _driverMode(0), _enabledMode(0), _disabledMode(0), _updateMode(0), _phaseBalancer(0),
+      _isInitialized(false),
+      _isProxyAddresser(false),
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      _phaseBeginsDirty(false),
+      _glitchFreeUpdates(false),
+#endif
+      _oscFrequency(PCA9685_OSC_FREQUENCY),
+      _preScalerVal(0),
+      _lastI2CError(_bus ? 0 : 4)
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      , _phaseOffsets()
+#endif
+{
+    resetChannelCache();
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    resetStats();
+#endif
+}
 
 #else
 
 PCA9685::PCA9685(byte i2cAddress)
     : _i2cAddress(i2cAddress),
-      _readBytes(0),
-      _driverMode(PCA9685_OutputDriverMode_Undefined),
-      _enabledMode(PCA9685_OutputEnabledMode_Undefined),
-      _disabledMode(PCA9685_OutputDisabledMode_Undefined),
-      _updateMode(PCA9685_ChannelUpdateMode_Undefined),
-      _phaseBalancer(PCA9685_PhaseBalancer_Undefined),
+      _driverMode(0), _enabledMode(0), _disabledMode(0), _updateMode(0), _phaseBalancer(0),
+      _isInitialized(false),
       _isProxyAddresser(false),
-      _lastI2CError(0)
-{ }
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      _phaseBeginsDirty(false),
+      _glitchFreeUpdates(false),
+#endif
+      _oscFrequency(PCA9685_OSC_FREQUENCY),
+      _preScalerVal(0),
+      _lastI2CError(0),
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+      _phaseOffsets(),
+#endif
+      _readBytes(0)
+{
+    resetChannelCache();
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    resetStats();
+#endif
+}
 
 #endif // /ifndef PCA9685_USE_SOFTWARE_I2C
 
 void PCA9685::resetDevices() {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Init);
+
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     Serial.println("PCA9685::resetDevices");
 #endif
@@ -119,11 +186,21 @@ void PCA9685::resetDevices() {
     i2cWire_write(PCA9685_SW_RESET);
     i2cWire_endTransmission();
 
+#ifdef PCA9685_ENABLE_TRACE
+    traceEvent(PCA9685_TraceOp_Reset, PCA9685_SW_RESET, 0, 0, _lastI2CError);
+#endif
+#ifdef PCA9685_ENABLE_RECORDER
+    if (_recorder && !_lastI2CError) _recorder->recordReset();
+#endif
+
     delayMicroseconds(10);
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     checkForErrors();
 #endif
+
+    resetChannelCache(); // Software reset puts all channels at full off
+    _preScalerVal = 0;
 }
 
 void PCA9685::init(PCA9685_OutputDriverMode driverMode,
@@ -131,6 +208,8 @@ void PCA9685::init(PCA9685_OutputDriverMode driverMode,
                    PCA9685_OutputDisabledMode disabledMode,
                    PCA9685_ChannelUpdateMode updateMode,
                    PCA9685_PhaseBalancer phaseBalancer) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Init);
+
     if (_isProxyAddresser) return;
 
     _i2cAddress = PCA9685_I2C_BASE_MODULE_ADDRESS | (_i2cAddress & PCA9685_I2C_BASE_MODULE_ADRMASK);
@@ -140,10 +219,13 @@ void PCA9685::init(PCA9685_OutputDriverMode driverMode,
     _disabledMode = disabledMode;
     _updateMode = updateMode;
     _phaseBalancer = phaseBalancer;
+    _isInitialized = true;
+    resetChannelCache();
+    _preScalerVal = 0;
 
-    assert(!(_driverMode == PCA9685_OutputDriverMode_OpenDrain && _disabledMode == PCA9685_OutputDisabledMode_High && "Unsupported combination"));
+    assert(!(driverMode == PCA9685_OutputDriverMode_OpenDrain && disabledMode == PCA9685_OutputDisabledMode_High && "Unsupported combination"));
 
-    byte mode2Val = getMode2Value();
+    byte mode2Val = PCA9685_Detail::getMode2Value(driverMode, enabledMode, disabledMode, updateMode);
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     Serial.print("PCA9685::init mode2Val: 0x");
@@ -155,45 +237,49 @@ void PCA9685::init(PCA9685_OutputDriverMode driverMode,
     Serial.print(", i2cSpeed: ");
     Serial.print(roundf(getI2CSpeed() / 1000.0f)); Serial.print("kHz");
     Serial.print(", driverMode: ");
-    switch(_driverMode) {
+    switch(driverMode) {
         case PCA9685_OutputDriverMode_OpenDrain: Serial.print("OpenDrain"); break;
         case PCA9685_OutputDriverMode_TotemPole: Serial.print("TotemPole"); break;
         case PCA9685_OutputDriverMode_Count:
         case PCA9685_OutputDriverMode_Undefined:
-            Serial.print(_driverMode); break;
+            Serial.print(driverMode); break;
     }
     Serial.print(", enabledMode: ");
-    switch (_enabledMode) {
+    switch (enabledMode) {
         case PCA9685_OutputEnabledMode_Normal: Serial.print("Normal"); break;
         case PCA9685_OutputEnabledMode_Inverted: Serial.print("Inverted"); break;
         case PCA9685_OutputEnabledMode_Count:
         case PCA9685_OutputEnabledMode_Undefined:
-            Serial.print(_enabledMode); break;
+            Serial.print(enabledMode); break;
     }
     Serial.print(", disabledMode: ");
-    switch (_disabledMode) {
+    switch (disabledMode) {
         case PCA9685_OutputDisabledMode_Low: Serial.print("Low"); break;
         case PCA9685_OutputDisabledMode_High: Serial.print("High"); break;
         case PCA9685_OutputDisabledMode_Floating: Serial.print("Floating"); break;
         case PCA9685_OutputDisabledMode_Count:
         case PCA9685_OutputDisabledMode_Undefined:
-            Serial.print(_disabledMode); break;
+            Serial.print(disabledMode); break;
     }
     Serial.print(", updateMode: ");
-    switch (_updateMode) {
+    switch (updateMode) {
         case PCA9685_ChannelUpdateMode_AfterStop: Serial.print("AfterStop"); break;
         case PCA9685_ChannelUpdateMode_AfterAck: Serial.print("AfterAck"); break;
         case PCA9685_ChannelUpdateMode_Count:
         case PCA9685_ChannelUpdateMode_Undefined:
-            Serial.print(_updateMode); break;
+            Serial.print(updateMode); break;
     }
     Serial.print(", phaseBalancer: ");
-    switch(_phaseBalancer) {
+    switch(phaseBalancer) {
         case PCA9685_PhaseBalancer_None: Serial.print("None"); break;
         case PCA9685_PhaseBalancer_Linear: Serial.print("Linear"); break;
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+        case PCA9685_PhaseBalancer_Packed: Serial.print("Packed"); break;
+        case PCA9685_PhaseBalancer_Custom: Serial.print("Custom"); break;
+#endif
         case PCA9685_PhaseBalancer_Count:
         case PCA9685_PhaseBalancer_Undefined:
-            Serial.print(_phaseBalancer); break;
+            Serial.print(phaseBalancer); break;
     }
     Serial.println("");
 #endif
@@ -204,8 +290,7 @@ void PCA9685::init(PCA9685_OutputDriverMode driverMode,
     checkForErrors();
 #endif
 
-    writeRegister(PCA9685_MODE1_REG, PCA9685_MODE1_RESTART | PCA9685_MODE1_AUTOINC);
-    writeRegister(PCA9685_MODE2_REG, mode2Val);
+    PCA9685_Core::writeModes(*this, mode2Val);
 }
 
 void PCA9685::init(PCA9685_PhaseBalancer phaseBalancer,
@@ -213,11 +298,15 @@ void PCA9685::init(PCA9685_PhaseBalancer phaseBalancer,
                    PCA9685_OutputEnabledMode enabledMode,
                    PCA9685_OutputDisabledMode disabledMode,
                    PCA9685_ChannelUpdateMode updateMode) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Init);
+
     init(driverMode, enabledMode, disabledMode, updateMode, phaseBalancer);
 }
 
 void PCA9685::initAsProxyAddresser() {
-    if (_driverMode != PCA9685_OutputDriverMode_Undefined) return;
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Init);
+
+    if (_isInitialized) return;
 
     _i2cAddress = PCA9685_I2C_BASE_PROXY_ADDRESS | (_i2cAddress & PCA9685_I2C_BASE_PROXY_ADRMASK);
     _isProxyAddresser = true;
@@ -245,7 +334,7 @@ byte PCA9685::getI2CAddress() {
 
 uint32_t PCA9685::getI2CSpeed() {
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    return _i2cSpeed;
+    return _bus ? _bus->_i2cSpeed : 0;
 #else
 #if I2C_FASTMODE || F_CPU >= 16000000
     return 400000;
@@ -256,111 +345,178 @@ uint32_t PCA9685::getI2CSpeed() {
 }
 
 PCA9685_OutputDriverMode PCA9685::getOutputDriverMode() {
-    return _driverMode;
+    return _isInitialized ? (PCA9685_OutputDriverMode)_driverMode : PCA9685_OutputDriverMode_Undefined;
 }
 
 PCA9685_OutputEnabledMode PCA9685::getOutputEnabledMode() {
-    return _enabledMode;
+    return _isInitialized ? (PCA9685_OutputEnabledMode)_enabledMode : PCA9685_OutputEnabledMode_Undefined;
 }
 
 PCA9685_OutputDisabledMode PCA9685::getOutputDisabledMode() {
-    return _disabledMode;
+    return _isInitialized ? (PCA9685_OutputDisabledMode)_disabledMode : PCA9685_OutputDisabledMode_Undefined;
 }
 
 PCA9685_ChannelUpdateMode PCA9685::getChannelUpdateMode() {
-    return _updateMode;
+    return _isInitialized ? (PCA9685_ChannelUpdateMode)_updateMode : PCA9685_ChannelUpdateMode_Undefined;
 }
 
 PCA9685_PhaseBalancer PCA9685::getPhaseBalancer() {
-    return _phaseBalancer;
+    return _isInitialized ? (PCA9685_PhaseBalancer)_phaseBalancer : PCA9685_PhaseBalancer_Undefined;
 }
 
-byte PCA9685::getMode2Value() {
-    byte mode2Val = (byte)0x00;
+void PCA9685::setPWMFrequency(float pwmFrequency) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetPWMFrequency);
 
-    if (_driverMode == PCA9685_OutputDriverMode_TotemPole) {
-        mode2Val |= PCA9685_MODE2_OUTDRV_TPOLE;
-    }
+    setPWMFrequency(pwmFrequency, _oscFrequency);
+}
 
-    if (_enabledMode == PCA9685_OutputEnabledMode_Inverted) {
-        mode2Val |= PCA9685_MODE2_INVRT;
-    }
+void PCA9685::setPWMFrequency(float pwmFrequency, uint32_t oscFrequency) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetPWMFrequency);
 
-    if (_disabledMode == PCA9685_OutputDisabledMode_High) {
-        mode2Val |= PCA9685_MODE2_OUTNE_TPHIGH;
-    }
-    else if (_disabledMode == PCA9685_OutputDisabledMode_Floating) {
-        mode2Val |= PCA9685_MODE2_OUTNE_HIGHZ;
-    }
+    if (pwmFrequency <= 0 || _isProxyAddresser) return;
 
-    if (_updateMode == PCA9685_ChannelUpdateMode_AfterAck) {
-        mode2Val |= PCA9685_MODE2_OCH_ONACK;
-    }
+    _oscFrequency = oscFrequency;
 
-    return mode2Val;
+    setPWMFrequencyQ4(PCA9685_Detail::getPWMFrequencyQ4(pwmFrequency));
 }
 
-void PCA9685::setPWMFrequency(float pwmFrequency) {
-    if (pwmFrequency < 0 || _isProxyAddresser) return;
+void PCA9685::setPWMFrequencyQ4(uint16_t pwmFrequencyQ4) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetPWMFrequency);
 
-    // This equation comes from section 7.3.5 of the datasheet, but the rounding has been
-    // removed because it isn't needed. Lowest freq is 23.84, highest is 1525.88.
-    int preScalerVal = (25000000 / (4096 * pwmFrequency)) - 1;
-    if (preScalerVal > 255) preScalerVal = 255;
-    if (preScalerVal < 3) preScalerVal = 3;
+    if (pwmFrequencyQ4 == 0 || _isProxyAddresser) return;
+
+    byte preScalerVal = PCA9685_Detail::getPreScalerValue(_oscFrequency, pwmFrequencyQ4);
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.print("PCA9685::setPWMFrequency pwmFrequency: ");
-    Serial.print(pwmFrequency);
+    Serial.print("PCA9685::setPWMFrequencyQ4 pwmFrequency: ");
+    Serial.print(pwmFrequencyQ4 / 16.0f);
+    Serial.print(", oscFrequency: ");
+    Serial.print(_oscFrequency);
     Serial.print(", preScalerVal: 0x");
-    Serial.println(preScalerVal, HEX);
+    Serial.print(preScalerVal, HEX);
+    Serial.print(", actual pwmFrequency: ");
+    Serial.println(_oscFrequency / (4096.0f * (preScalerVal + 1)));
 #endif
 
-    // The PRE_SCALE register can only be set when the SLEEP bit of MODE1 register is set to logic 1.
-    byte mode1Reg = readRegister(PCA9685_MODE1_REG);
-    writeRegister(PCA9685_MODE1_REG, (mode1Reg = (mode1Reg & ~PCA9685_MODE1_RESTART) | PCA9685_MODE1_SLEEP));
-    writeRegister(PCA9685_PRESCALE_REG, (byte)preScalerVal);
+    if (preScalerVal == _preScalerVal) { // Already running at this pre-scaler value
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+        _stats.suppressedWrites++;
+#endif
+        return;
+    }
 
-    // It takes 500us max for the oscillator to be up and running once SLEEP bit has been set to logic 0.
-    writeRegister(PCA9685_MODE1_REG, (mode1Reg = (mode1Reg & ~PCA9685_MODE1_SLEEP) | PCA9685_MODE1_RESTART));
-    delayMicroseconds(500);
+    // Cached pre-scaler is left unknown until every step of the write has gone through.
+    _preScalerVal = 0;
+    if (PCA9685_Core::writePreScaler(*this, preScalerVal)) _preScalerVal = preScalerVal;
 }
 
 void PCA9685::setPWMFreqServo() {
-    setPWMFrequency(50);
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetPWMFrequency);
+
+    setPWMFrequencyQ4(50 << 4);
+}
+
+float PCA9685::getPWMFrequency() {
+    if (_isProxyAddresser) return 0;
+
+    byte preScalerVal = readRegister(PCA9685_PRESCALE_REG);
+    if (_lastI2CError) return 0;
+    _preScalerVal = preScalerVal;
+
+    return _oscFrequency / (4096.0f * (preScalerVal + 1));
+}
+
+void PCA9685::calibrateOscFrequency(float measuredPWMFrequency) {
+    if (measuredPWMFrequency <= 0 || _isProxyAddresser) return;
+
+    byte preScalerVal = readRegister(PCA9685_PRESCALE_REG);
+    if (_lastI2CError) return;
+    _preScalerVal = preScalerVal;
+
+    // Inverse of datasheet equation, as measured frequency is the true one produced
+    _oscFrequency = (uint32_t)roundf(measuredPWMFrequency * 4096.0f * (preScalerVal + 1));
+
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.print("PCA9685::calibrateOscFrequency measuredPWMFrequency: ");
+    Serial.print(measuredPWMFrequency);
+    Serial.print(", preScalerVal: 0x");
+    Serial.print(preScalerVal, HEX);
+    Serial.print(", oscFrequency: ");
+    Serial.println(_oscFrequency);
+#endif
+}
+
+void PCA9685::setOscFrequency(uint32_t oscFrequency) {
+    _oscFrequency = oscFrequency;
+}
+
+uint32_t PCA9685::getOscFrequency() {
+    return _oscFrequency;
 }
 
 void PCA9685::setChannelOn(int channel) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPWM);
+
     if (channel < 0 || channel > 15) return;
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     Serial.println("PCA9685::setChannelOn");
 #endif
 
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    if (_phaseBalancer == PCA9685_PhaseBalancer_Packed || _glitchFreeUpdates) {
+        setChannelPWM(channel, PCA9685_PWM_FULL);
+        return;
+    }
+#endif
+
     writeChannelBegin(channel);
     writeChannelPWM(PCA9685_PWM_FULL, 0);  // time_on = FULL; time_off = 0;
     writeChannelEnd();
+
+    // Channel cache is kept current for all balancers, such as for phase planning
+    if (!_lastI2CError) updateChannelCache(channel, PCA9685_PWM_FULL, 0);
+    else invalidateChannelCache();
 }
 
 void PCA9685::setChannelOff(int channel) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPWM);
+
     if (channel < 0 || channel > 15) return;
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     Serial.println("PCA9685::setChannelOff");
 #endif
 
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    if (_phaseBalancer == PCA9685_PhaseBalancer_Packed || _glitchFreeUpdates) {
+        setChannelPWM(channel, 0);
+        return;
+    }
+#endif
+
     writeChannelBegin(channel);
     writeChannelPWM(0, PCA9685_PWM_FULL);  // time_on = 0; time_off = FULL;
     writeChannelEnd();
+
+    // Channel cache is kept current for all balancers, such as for phase planning
+    if (!_lastI2CError) updateChannelCache(channel, 0, PCA9685_PWM_FULL);
+    else invalidateChannelCache();
 }
 
 void PCA9685::setChannelPWM(int channel, uint16_t pwmAmount) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPWM);
+
     if (channel < 0 || channel > 15) return;
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     Serial.println("PCA9685::setChannelPWM");
 #endif
 
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // Goes through channel cache, and other channels' phases may need to move
+    setChannelsPWM(channel, 1, &pwmAmount);
+#else
     writeChannelBegin(channel);
 
     uint16_t phaseBegin, phaseEnd;
@@ -369,9 +525,12 @@ void PCA9685::setChannelPWM(int channel, uint16_t pwmAmount) {
     writeChannelPWM(phaseBegin, phaseEnd);
 
     writeChannelEnd();
+#endif
 }
 
 void PCA9685::setChannelsPWM(int begChannel, int numChannels, const uint16_t *pwmAmounts) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelsPWM);
+
     if (begChannel < 0 || begChannel > 15 || numChannels < 0) return;
     if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
 
@@ -380,134 +539,238 @@ void PCA9685::setChannelsPWM(int begChannel, int numChannels, const uint16_t *pw
     Serial.println(numChannels);
 #endif
 
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    if (_phaseBalancer == PCA9685_PhaseBalancer_Packed && !_glitchFreeUpdates) {
+        // Packed phases depend upon all channels' PWM amounts, so new amounts are stored
+        // first, and the written range grows to cover any other channels whose phase has
+        // moved, with their values then sourced from the stored amounts.
+        int endChannel = begChannel + numChannels;
+
+        for (int channel = begChannel; channel < endChannel; ++channel) {
+            uint16_t pwmAmount = min(pwmAmounts[channel - begChannel], PCA9685_PWM_FULL);
+            if (_pwmAmounts[channel] != pwmAmount) {
+                _pwmAmounts[channel] = pwmAmount;
+                _phaseBeginsDirty = true;
+            }
+        }
+
+        updatePackedPhaseBegins(&begChannel, &endChannel);
+
+        numChannels = endChannel - begChannel;
+        pwmAmounts = &_pwmAmounts[begChannel];
+    }
+#endif
+
     // From avr/libraries/Wire.h and avr/libraries/utility/twi.h, BUFFER_LENGTH controls
     // how many channels can be written at once. Therefore, we loop around until all
     // channels have been written out into their registers. I2C_BUFFER_LENGTH is used in
     // other architectures, so we rely on PCA9685_I2C_BUFFER_LENGTH logic to sort it out.
+#ifndef PCA9685_USE_SOFTWARE_I2C
+    const int maxChannelsPerWrite = (PCA9685_I2C_BUFFER_LENGTH - 1) / 4;
+#else // TODO: Software I2C doesn't have buffer length restrictions? -NR
+    const int maxChannelsPerWrite = 16;
+#endif
+
+    if (!PCA9685_Core::writeChannelsPWM(*this, begChannel, numChannels, pwmAmounts, maxChannelsPerWrite)) {
+        // Unknown what made it out, so force all phases to be rewritten next time
+        invalidateChannelCache();
+    }
+}
+
+void PCA9685::setAllChannelsPWM(uint16_t pwmAmount) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetAllChannelsPWM);
+
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.println("PCA9685::setAllChannelsPWM");
+#endif
+
+    writeChannelBegin(PCA9685_ALLLED_CHANNEL);
+
+    uint16_t phaseBegin, phaseEnd;
+    getPhaseCycle(PCA9685_ALLLED_CHANNEL, pwmAmount, &phaseBegin, &phaseEnd);
+
+    writeChannelPWM(phaseBegin, phaseEnd);
+
+    writeChannelEnd();
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // ALLLED leaves every channel at the same unshifted phase
+    for (int channel = 0; channel < 16; ++channel) {
+        _pwmAmounts[channel] = min(pwmAmount, PCA9685_PWM_FULL);
+        _phaseBegins[channel] = 0;
+    }
+    _phaseBeginsDirty = true;
+#endif
+}
+
+void PCA9685::setChannelPhase(int channel, uint16_t phaseBegin, uint16_t phaseEnd) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPhase);
+
+    setChannelsPhase(channel, 1, &phaseBegin, &phaseEnd);
+}
+
+void PCA9685::setChannelsPhase(int begChannel, int numChannels, const uint16_t *phaseBegins, const uint16_t *phaseEnds) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPhase);
+
+    if (begChannel < 0 || begChannel > 15 || numChannels < 0) return;
+    if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
+
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.print("PCA9685::setChannelsPhase numChannels: ");
+    Serial.println(numChannels);
+#endif
+
+    // Same as with setChannelsPWM, buffer length controls how many channels can be
+    // written at once, so we loop around until all channels have been written out.
 
     while (numChannels > 0) {
         writeChannelBegin(begChannel);
 
 #ifndef PCA9685_USE_SOFTWARE_I2C
         int maxChannels = min(numChannels, (PCA9685_I2C_BUFFER_LENGTH - 1) / 4);
-#else // TODO: Software I2C doesn't have buffer length restrictions? -NR
+#else
         int maxChannels = numChannels;
 #endif
         while (maxChannels-- > 0) {
-            uint16_t phaseBegin, phaseEnd;
-            getPhaseCycle(begChannel++, *pwmAmounts++, &phaseBegin, &phaseEnd);
+            uint16_t phaseBegin = *phaseBegins++;
+            uint16_t phaseEnd = *phaseEnds++;
+            if (phaseBegin > PCA9685_PWM_FULL) phaseBegin = PCA9685_PWM_FULL;
+            if (phaseEnd > PCA9685_PWM_FULL) phaseEnd = PCA9685_PWM_FULL;
 
             writeChannelPWM(phaseBegin, phaseEnd);
+            updateChannelCache(begChannel++, phaseBegin, phaseEnd);
             --numChannels;
         }
 
         writeChannelEnd();
-        if (_lastI2CError) return;
+        if (_lastI2CError) {
+            // Unknown what made it out, so force all phases to be rewritten next time
+            invalidateChannelCache();
+            return;
+        }
     }
 }
 
-void PCA9685::setAllChannelsPWM(uint16_t pwmAmount) {
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+void PCA9685::setChannelPhaseOffset(int channel, uint16_t phaseOffset) {
+    setChannelsPhaseOffset(channel, 1, &phaseOffset);
+}
+
+void PCA9685::setChannelsPhaseOffset(int begChannel, int numChannels, const uint16_t *phaseOffsets) {
+    if (begChannel < 0 || begChannel > 15 || numChannels < 0) return;
+    if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
+
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.println("PCA9685::setAllChannelsPWM");
+    Serial.print("PCA9685::setChannelsPhaseOffset numChannels: ");
+    Serial.println(numChannels);
 #endif
 
-    writeChannelBegin(PCA9685_ALLLED_CHANNEL);
-
-    uint16_t phaseBegin, phaseEnd;
-    getPhaseCycle(PCA9685_ALLLED_CHANNEL, pwmAmount, &phaseBegin, &phaseEnd);
+    while (numChannels-- > 0)
+        _phaseOffsets[begChannel++] = *phaseOffsets++ & PCA9685_PWM_MASK;
 
-    writeChannelPWM(phaseBegin, phaseEnd);
+    _phaseBalancer = PCA9685_PhaseBalancer_Custom;
+}
 
-    writeChannelEnd();
+uint16_t PCA9685::getChannelPhaseOffset(int channel) {
+    if (channel < 0 || channel > 15) return 0;
+    return _phaseOffsets[channel];
 }
 
+#endif // /ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
 uint16_t PCA9685::getChannelPWM(int channel) {
-    if (channel < 0 || channel > 15 || _isProxyAddresser) return 0;
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_GetChannelPWM);
+
+    uint16_t pwmAmount;
+    getChannelsPWM(channel, 1, &pwmAmount);
+    return pwmAmount;
+}
+
+void PCA9685::getChannelsPWM(int begChannel, int numChannels, uint16_t *pwmAmounts) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_GetChannelsPWM);
 
-    byte regAddress = PCA9685_LED0_REG + (channel << 2);
+    if (numChannels < 0) return;
+    if (begChannel < 0 || begChannel > 15 || _isProxyAddresser) {
+        memset(pwmAmounts, 0, numChannels * sizeof(uint16_t));
+        return;
+    }
+    if (begChannel + numChannels > 16) {
+        memset(pwmAmounts + (16 - begChannel), 0, ((begChannel + numChannels) - 16) * sizeof(uint16_t));
+        numChannels -= (begChannel + numChannels) - 16;
+    }
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.print("PCA9685::getChannelPWM channel: ");
-    Serial.print(channel);
-    Serial.print(", regAddress: 0x");
-    Serial.println(regAddress, HEX);
+    Serial.print("PCA9685::getChannelsPWM numChannels: ");
+    Serial.println(numChannels);
 #endif
 
-    i2cWire_beginTransmission(_i2cAddress);
-    i2cWire_write(regAddress);
-    if (i2cWire_endTransmission()) {
+    // Same as with setChannelsPWM, buffer length controls how many channels can be read
+    // at once, so we loop around until all channels have been read from their registers.
+
+    while (numChannels > 0) {
+        byte regAddress = PCA9685_LED0_REG + (begChannel << 2);
+
+#ifndef PCA9685_USE_SOFTWARE_I2C
+        int maxChannels = min(numChannels, PCA9685_I2C_BUFFER_LENGTH / 4);
+#else
+        int maxChannels = numChannels;
+#endif
+
+        i2cWire_beginTransmission(_i2cAddress);
+        i2cWire_write(regAddress);
+        if (i2cWire_endTransmission()) {
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-        checkForErrors();
+            checkForErrors();
 #endif
-        return 0;
-    }
+            memset(pwmAmounts, 0, numChannels * sizeof(uint16_t)); // Unread channels as 0, same as getChannelPWM
+            return;
+        }
 
-    int bytesRead = i2cWire_requestFrom((uint8_t)_i2cAddress, 4);
-    if (bytesRead != 4) {
-        while (bytesRead-- > 0)
-            i2cWire_read();
+        int bytesRead = i2cWire_requestFrom((uint8_t)_i2cAddress, (uint8_t)(maxChannels * 4));
+        if (bytesRead != maxChannels * 4) {
+            while (bytesRead-- > 0)
+                i2cWire_read();
 #ifdef PCA9685_USE_SOFTWARE_I2C
-        PCA9685_i2c_stop(); // Manually have to send stop bit in software i2c mode
+            PCA9685_i2c_stop(); // Manually have to send stop bit in software i2c mode
 #endif
-        _lastI2CError = 4;
+            _lastI2CError = 4;
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-        checkForErrors();
+            checkForErrors();
 #endif
-        return 0;
-    }
+            memset(pwmAmounts, 0, numChannels * sizeof(uint16_t));
+            return;
+        }
 
+        while (maxChannels-- > 0) {
 #ifndef PCA9685_SWAP_PWM_BEG_END_REGS
-    uint16_t phaseBegin = (uint16_t)i2cWire_read();
-    phaseBegin |= (uint16_t)i2cWire_read() << 8;
-    uint16_t phaseEnd = (uint16_t)i2cWire_read();
-    phaseEnd |= (uint16_t)i2cWire_read() << 8;
+            uint16_t phaseBegin = (uint16_t)i2cWire_read();
+            phaseBegin |= (uint16_t)i2cWire_read() << 8;
+            uint16_t phaseEnd = (uint16_t)i2cWire_read();
+            phaseEnd |= (uint16_t)i2cWire_read() << 8;
 #else
-    uint16_t phaseEnd = (uint16_t)i2cWire_read();
-    phaseEnd |= (uint16_t)i2cWire_read() << 8;
-    uint16_t phaseBegin = (uint16_t)i2cWire_read();
-    phaseBegin |= (uint16_t)i2cWire_read() << 8;
-#endif
-    
-#ifdef PCA9685_USE_SOFTWARE_I2C
-    PCA9685_i2c_stop(); // Manually have to send stop bit in software i2c mode
+            uint16_t phaseEnd = (uint16_t)i2cWire_read();
+            phaseEnd |= (uint16_t)i2cWire_read() << 8;
+            uint16_t phaseBegin = (uint16_t)i2cWire_read();
+            phaseBegin |= (uint16_t)i2cWire_read() << 8;
 #endif
-
-#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.print("  PCA9685::getChannelPWM phaseBegin: ");
-    Serial.print(phaseBegin);
-    Serial.print(", phaseEnd: ");
-    Serial.println(phaseEnd);
+#ifdef PCA9685_ENABLE_TRACE
+            traceEvent(PCA9685_TraceOp_ChannelRead, PCA9685_LED0_REG + (begChannel << 2), phaseBegin, phaseEnd);
 #endif
+            *pwmAmounts++ = PCA9685_Detail::getPWMForPhaseCycle(phaseBegin, phaseEnd);
+            updateChannelCache(begChannel++, phaseBegin, phaseEnd);
+            --numChannels;
+        }
 
-    // See datasheet section 7.3.3
-    uint16_t retVal;
-    if (phaseEnd >= PCA9685_PWM_FULL)
-        // Full OFF
-        // Figure 11 Example 4: full OFF takes precedence over full ON
-        // See also remark after Table 7
-        retVal = 0;
-    else if (phaseBegin >= PCA9685_PWM_FULL)
-        // Full ON
-        // Figure 9 Example 3
-        retVal = PCA9685_PWM_FULL;
-    else if (phaseBegin <= phaseEnd)
-        // start and finish in same cycle
-        // Section 7.3.3 example 1
-        retVal = phaseEnd - phaseBegin;
-    else
-        // span cycles
-        // Section 7.3.3 example 2
-        retVal = (phaseEnd + PCA9685_PWM_FULL) - phaseBegin;
-
-#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.print("  PCA9685::getChannelPWM retVal: ");
-    Serial.println(retVal);
+#ifdef PCA9685_USE_SOFTWARE_I2C
+        PCA9685_i2c_stop(); // Manually have to send stop bit in software i2c mode
 #endif
-
-    return retVal;
+    }
 }
 
 void PCA9685::enableAllCallAddress(byte i2cAddressAllCall) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
     byte i2cAddress = PCA9685_I2C_BASE_PROXY_ADDRESS | (i2cAddressAllCall & PCA9685_I2C_BASE_PROXY_ADRMASK);
@@ -524,6 +787,8 @@ void PCA9685::enableAllCallAddress(byte i2cAddressAllCall) {
 }
 
 void PCA9685::enableSub1Address(byte i2cAddressSub1) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
     byte i2cAddress = PCA9685_I2C_BASE_PROXY_ADDRESS | (i2cAddressSub1 & PCA9685_I2C_BASE_PROXY_ADRMASK);
@@ -540,6 +805,8 @@ void PCA9685::enableSub1Address(byte i2cAddressSub1) {
 }
 
 void PCA9685::enableSub2Address(byte i2cAddressSub2) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
     byte i2cAddress = PCA9685_I2C_BASE_PROXY_ADDRESS | (i2cAddressSub2 & PCA9685_I2C_BASE_PROXY_ADRMASK);
@@ -556,6 +823,8 @@ void PCA9685::enableSub2Address(byte i2cAddressSub2) {
 }
 
 void PCA9685::enableSub3Address(byte i2cAddressSub3) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
     byte i2cAddress = PCA9685_I2C_BASE_PROXY_ADDRESS | (i2cAddressSub3 & PCA9685_I2C_BASE_PROXY_ADRMASK);
@@ -572,6 +841,8 @@ void PCA9685::enableSub3Address(byte i2cAddressSub3) {
 }
 
 void PCA9685::disableAllCallAddress() {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
@@ -583,6 +854,8 @@ void PCA9685::disableAllCallAddress() {
 }
 
 void PCA9685::disableSub1Address() {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
@@ -594,6 +867,8 @@ void PCA9685::disableSub1Address() {
 }
 
 void PCA9685::disableSub2Address() {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
@@ -605,6 +880,8 @@ void PCA9685::disableSub2Address() {
 }
 
 void PCA9685::disableSub3Address() {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
     if (_isProxyAddresser) return;
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
@@ -615,11 +892,16 @@ void PCA9685::disableSub3Address() {
     writeRegister(PCA9685_MODE1_REG, (mode1Reg &= ~PCA9685_MODE1_SUBADR3));
 }
 
-void PCA9685::enableExtClockLine() {
+void PCA9685::enableExtClockLine(uint32_t extClockFrequency) {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
+
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.println("PCA9685::enableExtClockLine");
+    Serial.print("PCA9685::enableExtClockLine extClockFrequency: ");
+    Serial.println(extClockFrequency);
 #endif
 
+    _oscFrequency = extClockFrequency;
+
     // The PRE_SCALE register can only be set when the SLEEP bit of MODE1 register is set to logic 1.
     byte mode1Reg = readRegister(PCA9685_MODE1_REG);
     writeRegister(PCA9685_MODE1_REG, (mode1Reg = (mode1Reg & ~PCA9685_MODE1_RESTART) | PCA9685_MODE1_SLEEP));
@@ -630,74 +912,502 @@ void PCA9685::enableExtClockLine() {
     delayMicroseconds(500);
 }
 
-byte PCA9685::getLastI2CError() {
-    return _lastI2CError;
-}
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
 
-void PCA9685::getPhaseCycle(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd) {
-    if (channel == PCA9685_ALLLED_CHANNEL) {
-        *phaseBegin = 0; // ALLLED should not receive a phase shifted begin value
-    } else {
-        // Get phase delay begin
-        switch(_phaseBalancer) {
-            case PCA9685_PhaseBalancer_None:
-            case PCA9685_PhaseBalancer_Count:
-            case PCA9685_PhaseBalancer_Undefined:
-                *phaseBegin = 0;
-                break;
+void PCA9685::enableGlitchFreeUpdates() {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
 
-            case PCA9685_PhaseBalancer_Linear:
-                // Distribute high phase area over more of the duty cycle range to balance load
-                *phaseBegin = (channel * ((4096 / 16) / 16)) & PCA9685_PWM_MASK;
-                break;
-        }
-    }
+    if (_isProxyAddresser) return;
 
-    // See datasheet section 7.3.3
-    if (pwmAmount == 0) {
-        // Full OFF -> time_end[bit12] = 1
-        *phaseEnd = PCA9685_PWM_FULL;
-    }
-    else if (pwmAmount >= PCA9685_PWM_FULL) {
-        // Full ON -> time_beg[bit12] = 1, time_end[bit12] = <ignored>
-        *phaseBegin |= PCA9685_PWM_FULL;
-        *phaseEnd = 0;
-    }
-    else {
-        *phaseEnd = (*phaseBegin + pwmAmount) & PCA9685_PWM_MASK;
-    }
-}
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.println("PCA9685::enableGlitchFreeUpdates");
+#endif
 
-void PCA9685::writeChannelBegin(int channel) {
-    byte regAddress;
+    // Channel cache must match what's actually in the module, since it may have been
+    // written by something else (e.g. before a restart), with any channel that fails to
+    // read back left unknown
+    invalidateChannelCache();
 
-    if (channel != PCA9685_ALLLED_CHANNEL)
-        regAddress = PCA9685_LED0_REG + (channel * 0x04);
-    else
-        regAddress = PCA9685_ALLLED_REG;
+    uint16_t pwmAmounts[16];
+    getChannelsPWM(0, 16, pwmAmounts);
+
+    _glitchFreeUpdates = true;
+}
+
+void PCA9685::disableGlitchFreeUpdates() {
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_Config);
 
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.print("  PCA9685::writeChannelBegin channel: ");
-    Serial.print(channel);
-    Serial.print(", regAddress: 0x");
-    Serial.println(regAddress, HEX);
+    Serial.println("PCA9685::disableGlitchFreeUpdates");
 #endif
 
-    i2cWire_beginTransmission(_i2cAddress);
-    i2cWire_write(regAddress);
+    _glitchFreeUpdates = false;
+    _phaseBeginsDirty = true; // Packed needs to put drifted phases back in place
 }
 
-void PCA9685::writeChannelPWM(uint16_t phaseBegin, uint16_t phaseEnd) {
-#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
-    Serial.print("  PCA9685::writeChannelPWM phaseBegin: ");
-    Serial.print(phaseBegin);
-    Serial.print(", phaseEnd: ");
-    Serial.println(phaseEnd);
-#endif
+bool PCA9685::getGlitchFreeUpdates() {
+    return _glitchFreeUpdates;
+}
 
-#ifndef PCA9685_SWAP_PWM_BEG_END_REGS
-    i2cWire_write(lowByte(phaseBegin));
-    i2cWire_write(highByte(phaseBegin));
+#endif // /ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+byte PCA9685::getLastI2CError() {
+    return _lastI2CError;
+}
+
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+
+const PCA9685_Stats &PCA9685::getStats() {
+    return _stats;
+}
+
+void PCA9685::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+#endif // /ifdef PCA9685_ENABLE_PERF_COUNTERS
+
+#ifdef PCA9685_ENABLE_TRACE
+
+PCA9685_TraceEvent PCA9685::_traceEvents[PCA9685_TRACE_SIZE];
+uint16_t PCA9685::_traceNext = 0;
+uint16_t PCA9685::_traceCount = 0;
+
+void PCA9685::traceEvent(byte op, byte regAddress, uint16_t value1, uint16_t value2, byte error) {
+    PCA9685_TraceEvent &event = _traceEvents[_traceNext];
+
+    event.timestamp = micros();
+    event.op = op;
+    event.i2cAddress = _txI2CAddress;
+    event.regAddress = regAddress;
+    event.error = error;
+    event.value1 = value1;
+    event.value2 = value2;
+
+    if (++_traceNext >= PCA9685_TRACE_SIZE) _traceNext = 0;
+    if (_traceCount < PCA9685_TRACE_SIZE) _traceCount++;
+}
+
+int PCA9685::getTraceEvents(PCA9685_TraceEvent *events, int maxEvents) {
+    int numEvents = min((int)_traceCount, maxEvents);
+    uint16_t index = (_traceNext + PCA9685_TRACE_SIZE - _traceCount) % PCA9685_TRACE_SIZE;
+
+    for (int i = 0; i < numEvents; ++i) {
+        events[i] = _traceEvents[index];
+        if (++index >= PCA9685_TRACE_SIZE) index = 0;
+    }
+
+    return numEvents;
+}
+
+void PCA9685::clearTrace() {
+    _traceNext = _traceCount = 0;
+}
+
+static const char *textForTraceOp(byte op) {
+    switch (op) {
+        case PCA9685_TraceOp_Reset: return "Reset";
+        case PCA9685_TraceOp_RegisterWrite: return "RegisterWrite";
+        case PCA9685_TraceOp_RegisterRead: return "RegisterRead";
+        case PCA9685_TraceOp_ChannelWrite: return "ChannelWrite";
+        case PCA9685_TraceOp_ChannelRead: return "ChannelRead";
+        case PCA9685_TraceOp_TransmissionEnd: return "TransmissionEnd";
+        case PCA9685_TraceOp_ReadRequest: return "ReadRequest";
+        default: return "<Unknown>";
+    }
+}
+
+void PCA9685::printTrace(Print &output) {
+    PCA9685_TraceEvent event;
+    uint16_t index = (_traceNext + PCA9685_TRACE_SIZE - _traceCount) % PCA9685_TRACE_SIZE;
+
+    output.println(""); output.print(" ~~~ PCA9685 Trace ("); output.print(_traceCount); output.println(" events) ~~~");
+
+    for (uint16_t i = 0; i < _traceCount; ++i) {
+        event = _traceEvents[index];
+        if (++index >= PCA9685_TRACE_SIZE) index = 0;
+
+        output.print(event.timestamp); output.print("us 0x");
+        output.print(event.i2cAddress, HEX); output.print(" ");
+        output.print(textForTraceOp(event.op));
+
+        switch (event.op) {
+            case PCA9685_TraceOp_RegisterWrite:
+            case PCA9685_TraceOp_RegisterRead:
+                output.print(" reg: 0x"); output.print(event.regAddress, HEX);
+                output.print(", value: 0x"); output.print(event.value1, HEX);
+                break;
+
+            case PCA9685_TraceOp_ChannelWrite:
+            case PCA9685_TraceOp_ChannelRead:
+                if (event.regAddress == PCA9685_ALLLED_REG)
+                    output.print(" channel: ALLLED");
+                else {
+                    output.print(" channel: "); output.print((event.regAddress - PCA9685_LED0_REG) >> 2);
+                }
+                output.print(", phaseBegin: "); output.print(event.value1);
+                output.print(", phaseEnd: "); output.print(event.value2);
+                output.print(", pwm: ");
+                output.print(event.value2 >= PCA9685_PWM_FULL ? 0 : event.value1 >= PCA9685_PWM_FULL ? PCA9685_PWM_FULL :
+                             (uint16_t)((event.value2 - event.value1) & PCA9685_PWM_MASK));
+                break;
+
+            case PCA9685_TraceOp_TransmissionEnd:
+                output.print(" bytes: "); output.print(event.value1);
+                break;
+
+            case PCA9685_TraceOp_ReadRequest:
+                output.print(" requested: "); output.print(event.value1);
+                output.print(", received: "); output.print(event.value2);
+                break;
+        }
+
+        if (event.error) {
+            output.print(", error: "); output.print(event.error);
+        }
+        output.println("");
+    }
+}
+
+#endif // /ifdef PCA9685_ENABLE_TRACE
+
+#ifdef PCA9685_ENABLE_LATENCY_HISTOGRAMS
+
+uint16_t PCA9685::_latencyBuckets[PCA9685_LatencyOp_Count][PCA9685_LATENCY_BUCKETS];
+uint32_t PCA9685::_latencyMaxes[PCA9685_LatencyOp_Count];
+byte PCA9685::_latencyDepth = 0;
+
+void PCA9685::recordLatency(PCA9685_LatencyOp op, uint32_t elapsed) {
+    if (elapsed > _latencyMaxes[op]) _latencyMaxes[op] = elapsed;
+
+    int bucket = 0;
+    while ((elapsed >>= 1) && bucket < PCA9685_LATENCY_BUCKETS - 1)
+        ++bucket;
+
+    if (_latencyBuckets[op][bucket] != 0xFFFF)
+        _latencyBuckets[op][bucket]++;
+}
+
+const uint16_t *PCA9685::getLatencyHistogram(PCA9685_LatencyOp op) {
+    return _latencyBuckets[op];
+}
+
+uint32_t PCA9685::getLatencyCount(PCA9685_LatencyOp op) {
+    uint32_t retVal = 0;
+    for (int bucket = 0; bucket < PCA9685_LATENCY_BUCKETS; ++bucket)
+        retVal += _latencyBuckets[op][bucket];
+    return retVal;
+}
+
+uint32_t PCA9685::getLatencyMax(PCA9685_LatencyOp op) {
+    return _latencyMaxes[op];
+}
+
+uint32_t PCA9685::getLatencyPercentile(PCA9685_LatencyOp op, uint8_t percentile) {
+    uint32_t count = getLatencyCount(op);
+    if (!count) return 0;
+
+    // Smallest number of calls that covers percentile, rounded up
+    uint32_t target = (count * constrain(percentile, 1, 100) + 99) / 100;
+    uint32_t seen = 0;
+
+    for (int bucket = 0; bucket < PCA9685_LATENCY_BUCKETS - 1; ++bucket) {
+        seen += _latencyBuckets[op][bucket];
+        if (seen >= target)
+            return min(((uint32_t)2 << bucket) - 1, _latencyMaxes[op]);
+    }
+
+    return _latencyMaxes[op];
+}
+
+void PCA9685::resetLatencyHistograms() {
+    memset(_latencyBuckets, 0, sizeof(_latencyBuckets));
+    memset(_latencyMaxes, 0, sizeof(_latencyMaxes));
+}
+
+static const char *textForLatencyOp(PCA9685_LatencyOp op) {
+    switch (op) {
+        case PCA9685_LatencyOp_Init: return "Init";
+        case PCA9685_LatencyOp_SetPWMFrequency: return "SetPWMFrequency";
+        case PCA9685_LatencyOp_SetChannelPWM: return "SetChannelPWM";
+        case PCA9685_LatencyOp_SetChannelsPWM: return "SetChannelsPWM";
+        case PCA9685_LatencyOp_SetAllChannelsPWM: return "SetAllChannelsPWM";
+        case PCA9685_LatencyOp_SetChannelPhase: return "SetChannelPhase";
+        case PCA9685_LatencyOp_GetChannelPWM: return "GetChannelPWM";
+        case PCA9685_LatencyOp_GetChannelsPWM: return "GetChannelsPWM";
+        case PCA9685_LatencyOp_Config: return "Config";
+        default: return "<Unknown>";
+    }
+}
+
+void PCA9685::printLatencyHistograms(Print &output) {
+    output.println(""); output.println(" ~~~ PCA9685 Latency Histograms ~~~");
+
+    for (int opIndex = 0; opIndex < PCA9685_LatencyOp_Count; ++opIndex) {
+        PCA9685_LatencyOp op = (PCA9685_LatencyOp)opIndex;
+        uint32_t count = getLatencyCount(op);
+        if (!count) continue;
+
+        output.print(textForLatencyOp(op));
+        output.print(" count: "); output.print(count);
+        output.print(", p50: "); output.print(getLatencyPercentile(op, 50));
+        output.print("us, p90: "); output.print(getLatencyPercentile(op, 90));
+        output.print("us, p99: "); output.print(getLatencyPercentile(op, 99));
+        output.print("us, max: "); output.print(_latencyMaxes[op]);
+        output.println("us");
+
+        for (int bucket = 0; bucket < PCA9685_LATENCY_BUCKETS; ++bucket) {
+            if (!_latencyBuckets[op][bucket]) continue;
+            output.print(bucket < PCA9685_LATENCY_BUCKETS - 1 ? "  <" : "  >=");
+            output.print((uint32_t)(bucket < PCA9685_LATENCY_BUCKETS - 1 ? 2 : 1) << bucket);
+            output.print("us: "); output.println(_latencyBuckets[op][bucket]);
+        }
+    }
+}
+
+#endif // /ifdef PCA9685_ENABLE_LATENCY_HISTOGRAMS
+
+void PCA9685::getPhaseCycle(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd) {
+    uint16_t phaseOffset = 0;
+
+    if (channel != PCA9685_ALLLED_CHANNEL) { // ALLLED should not receive a phase shifted begin value
+        // Get phase delay begin
+        switch(_phaseBalancer) {
+            case PCA9685_PhaseBalancer_None:
+                break;
+
+            case PCA9685_PhaseBalancer_Linear:
+                phaseOffset = PCA9685_Detail::getLinearPhaseBegin(channel);
+                break;
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+            case PCA9685_PhaseBalancer_Packed:
+                if (!_glitchFreeUpdates) {
+                    // Computed ahead of time by updatePackedPhaseBegins
+                    phaseOffset = _phaseBegins[channel];
+                }
+                else {
+                    // Written phases are left to drift, so only place where it would go
+                    for (int prevChannel = 0; prevChannel < channel; ++prevChannel)
+                        phaseOffset += _pwmAmounts[prevChannel];
+                    phaseOffset &= PCA9685_PWM_MASK;
+                }
+                break;
+
+            case PCA9685_PhaseBalancer_Custom:
+                phaseOffset = _phaseOffsets[channel];
+                break;
+#endif
+        }
+    }
+
+    PCA9685_Detail::getPhaseCycle(phaseOffset, pwmAmount, phaseBegin, phaseEnd);
+}
+
+void PCA9685::prepareChannelPWM(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd) {
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    if (_glitchFreeUpdates)
+        getGlitchFreePhaseCycle(channel, pwmAmount, phaseBegin, phaseEnd);
+    else
+#endif
+        getPhaseCycle(channel, pwmAmount, phaseBegin, phaseEnd);
+
+    updateChannelCache(channel, *phaseBegin, *phaseEnd);
+}
+
+void PCA9685::resetChannelCache() {
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    for (int channel = 0; channel < 16; ++channel) {
+        _pwmAmounts[channel] = 0;
+        _phaseBegins[channel] = 0;
+    }
+    _phaseBeginsDirty = false;
+#endif
+}
+
+void PCA9685::updateChannelCache(int channel, uint16_t phaseBegin, uint16_t phaseEnd) {
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    uint16_t pwmAmount = PCA9685_Detail::getPWMForPhaseCycle(phaseBegin, phaseEnd);
+    if (_pwmAmounts[channel] != pwmAmount) {
+        _pwmAmounts[channel] = pwmAmount;
+        _phaseBeginsDirty = true;
+    }
+    _phaseBegins[channel] = phaseBegin & PCA9685_PWM_MASK;
+#endif
+}
+
+void PCA9685::invalidateChannelCache() {
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    for (int channel = 0; channel < 16; ++channel)
+        _phaseBegins[channel] = PCA9685_PWM_FULL;
+    _phaseBeginsDirty = true;
+#endif
+}
+
+uint16_t PCA9685::getChangedChannels(uint16_t channelMask, const uint16_t *pwmAmounts) {
+#ifndef PCA9685_ENABLE_CHANNEL_CACHE
+    return channelMask; // Nothing known, so every channel counts as changed
+#else
+    uint16_t retVal = 0;
+
+    for (int channel = 0; channel < 16; ++channel) {
+        uint16_t channelBit = (uint16_t)1 << channel;
+        if ((channelMask & channelBit) && (_phaseBegins[channel] == PCA9685_PWM_FULL ||
+                                           _pwmAmounts[channel] != min(pwmAmounts[channel], PCA9685_PWM_FULL)))
+            retVal |= channelBit;
+    }
+
+    return retVal;
+#endif
+}
+
+int PCA9685::setChangedChannelsPWM(uint16_t channelMask, const uint16_t *pwmAmounts) {
+    int retVal = 0;
+    int channel = 0;
+
+    // Each run of consecutive channels goes out as one auto-incremented write, as starting
+    // a new transaction costs less bus time than rewriting an unchanged channel
+    while (channelMask) {
+        while (!(channelMask & 1)) {
+            channelMask >>= 1;
+            ++channel;
+        }
+        int begChannel = channel;
+        while (channelMask & 1) {
+            channelMask >>= 1;
+            ++channel;
+        }
+
+        setChannelsPWM(begChannel, channel - begChannel, &pwmAmounts[begChannel]);
+        if (getLastI2CError()) break; // Rest left for caller to retry
+        retVal += channel - begChannel;
+    }
+
+    return retVal;
+}
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+void PCA9685::getGlitchFreePhaseCycle(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd) {
+    uint16_t lastPWMAmount = _pwmAmounts[channel];
+    uint16_t lastPhaseBegin = _phaseBegins[channel];
+
+    if (lastPWMAmount == 0 || lastPWMAmount >= PCA9685_PWM_FULL || lastPhaseBegin > PCA9685_PWM_MASK ||
+        pwmAmount == 0 || pwmAmount >= PCA9685_PWM_FULL) {
+        // From full on/off there's no pulse to disturb, and to full on/off there's no pulse
+        // to keep whole, so phase balancer's layout can be used as-is. Going from full on
+        // to a PWM amount will keep the output high until the new trailing edge, however.
+        getPhaseCycle(channel, pwmAmount, phaseBegin, phaseEnd);
+    }
+    else if (pwmAmount >= lastPWMAmount) {
+        // Lengthen by moving trailing edge later: if counter hasn't reached the old edge yet
+        // the current pulse ends at the new edge, otherwise the output is already low and
+        // the new edge is passed over harmlessly until the next cycle.
+        *phaseBegin = lastPhaseBegin;
+        *phaseEnd = (lastPhaseBegin + pwmAmount) & PCA9685_PWM_MASK;
+    }
+    else {
+        // Shorten by moving leading edge later: if counter is inside the current pulse the
+        // output is already high and that pulse ends at the unchanged trailing edge,
+        // otherwise the next pulse simply begins at the new edge. Moving the trailing edge
+        // earlier instead would let the counter slip past it and skip the falling edge.
+        *phaseEnd = (lastPhaseBegin + lastPWMAmount) & PCA9685_PWM_MASK;
+        *phaseBegin = (*phaseEnd - pwmAmount) & PCA9685_PWM_MASK;
+    }
+
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.print("  PCA9685::getGlitchFreePhaseCycle channel: ");
+    Serial.print(channel);
+    Serial.print(", lastPhaseBegin: ");
+    Serial.print(lastPhaseBegin);
+    Serial.print(", lastPWMAmount: ");
+    Serial.println(lastPWMAmount);
+#endif
+}
+
+bool PCA9685::updatePackedPhaseBegins(int *begChannel, int *endChannel) {
+    if (!_phaseBeginsDirty) return false;
+    _phaseBeginsDirty = false;
+
+    // Each channel's high phase begins where the previous channel's ends, wrapping around
+    // the cycle, which keeps the number of channels high at any point in the cycle within
+    // one of the ideal average (sum of PWM amounts / 4096). Full on/off channels don't
+    // have a phase to move, but full on channels still take up an entire cycle's worth.
+    uint16_t phaseBegin = 0;
+    bool moved = false;
+
+    for (int channel = 0; channel < 16; ++channel) {
+        uint16_t pwmAmount = _pwmAmounts[channel];
+
+        if (_phaseBegins[channel] != phaseBegin) {
+            _phaseBegins[channel] = phaseBegin;
+
+            if (pwmAmount > 0 && pwmAmount < PCA9685_PWM_FULL) {
+                if (channel < *begChannel) *begChannel = channel;
+                if (channel >= *endChannel) *endChannel = channel + 1;
+                moved = true;
+            }
+        }
+
+        phaseBegin = (phaseBegin + pwmAmount) & PCA9685_PWM_MASK;
+    }
+
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.print("  PCA9685::updatePackedPhaseBegins begChannel: ");
+    Serial.print(*begChannel);
+    Serial.print(", endChannel: ");
+    Serial.println(*endChannel);
+#endif
+
+    return moved;
+}
+
+#endif // /ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+void PCA9685::writeChannelBegin(int channel) {
+    byte regAddress;
+
+    if (channel != PCA9685_ALLLED_CHANNEL)
+        regAddress = PCA9685_LED0_REG + (channel * 0x04);
+    else
+        regAddress = PCA9685_ALLLED_REG;
+
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.print("  PCA9685::writeChannelBegin channel: ");
+    Serial.println(channel);
+#endif
+
+    writeChannelRegBegin(regAddress);
+}
+
+void PCA9685::writeChannelRegBegin(byte regAddress) {
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.print("  PCA9685::writeChannelRegBegin regAddress: 0x");
+    Serial.println(regAddress, HEX);
+#endif
+
+    i2cWire_beginTransmission(_i2cAddress);
+    i2cWire_write(regAddress);
+
+#if defined(PCA9685_ENABLE_TRACE) || defined(PCA9685_ENABLE_RECORDER)
+    _txRegAddress = regAddress;
+#endif
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    _txChannels = 0;
+#endif
+}
+
+void PCA9685::writeChannelPWM(uint16_t phaseBegin, uint16_t phaseEnd) {
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.print("  PCA9685::writeChannelPWM phaseBegin: ");
+    Serial.print(phaseBegin);
+    Serial.print(", phaseEnd: ");
+    Serial.println(phaseEnd);
+#endif
+
+#ifndef PCA9685_SWAP_PWM_BEG_END_REGS
+    i2cWire_write(lowByte(phaseBegin));
+    i2cWire_write(highByte(phaseBegin));
     i2cWire_write(lowByte(phaseEnd));
     i2cWire_write(highByte(phaseEnd));
 #else
@@ -706,11 +1416,32 @@ void PCA9685::writeChannelPWM(uint16_t phaseBegin, uint16_t phaseEnd) {
     i2cWire_write(lowByte(phaseBegin));
     i2cWire_write(highByte(phaseBegin));
 #endif
+
+#ifdef PCA9685_ENABLE_TRACE
+    traceEvent(PCA9685_TraceOp_ChannelWrite, _txRegAddress, phaseBegin, phaseEnd);
+#endif
+#ifdef PCA9685_ENABLE_RECORDER
+    if (_recorder) _recorder->recordChannel(_i2cAddress, _txRegAddress, phaseBegin, phaseEnd);
+#endif
+#if defined(PCA9685_ENABLE_TRACE) || defined(PCA9685_ENABLE_RECORDER)
+    _txRegAddress += 4;
+#endif
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    if (_txChannels++) _stats.coalescedWrites++;
+#endif
 }
 
 void PCA9685::writeChannelEnd() {
     i2cWire_endTransmission();
 
+#ifdef PCA9685_ENABLE_RECORDER
+    // Channel writes only get recorded once they've actually gone out
+    if (_recorder) {
+        if (!_lastI2CError) _recorder->commitChannels();
+        else _recorder->discardChannels();
+    }
+#endif
+
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     checkForErrors();
 #endif
@@ -729,6 +1460,13 @@ void PCA9685::writeRegister(byte regAddress, byte value) {
     i2cWire_write(value);
     i2cWire_endTransmission();
 
+#ifdef PCA9685_ENABLE_TRACE
+    traceEvent(PCA9685_TraceOp_RegisterWrite, regAddress, value, 0, _lastI2CError);
+#endif
+#ifdef PCA9685_ENABLE_RECORDER
+    if (_recorder && !_lastI2CError) _recorder->recordRegister(_i2cAddress, regAddress, value);
+#endif
+
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     checkForErrors();
 #endif
@@ -774,54 +1512,135 @@ byte PCA9685::readRegister(byte regAddress) {
     Serial.println(retVal, HEX);
 #endif
 
+#ifdef PCA9685_ENABLE_TRACE
+    traceEvent(PCA9685_TraceOp_RegisterRead, regAddress, retVal);
+#endif
+
     return retVal;
 }
 
 void PCA9685::i2cWire_begin() {
-    _lastI2CError = 0;
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    _i2cWire->setClock(getI2CSpeed());
+    _lastI2CError = _bus ? 0 : 4;
+    if (_bus) _bus->_i2cWire->setClock(getI2CSpeed());
+#else
+    _lastI2CError = 0;
 #endif
 }
 
 void PCA9685::i2cWire_beginTransmission(uint8_t addr) {
     _lastI2CError = 0;
+#if defined(PCA9685_ENABLE_TRACE) || defined(PCA9685_ENABLE_BUS_PROFILER)
+    _txI2CAddress = addr;
+    _txBytes = 0;
+#endif
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+    _txBeginMicros = micros();
+#endif
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    _i2cWire->beginTransmission(addr);
+    if (_bus) _bus->_i2cWire->beginTransmission(addr);
 #else
     i2c_start(addr);
 #endif
 }
 
 uint8_t PCA9685::i2cWire_endTransmission(void) {
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    unsigned long beginMicros = micros();
+#endif
+
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    return (_lastI2CError = _i2cWire->endTransmission());
+    _lastI2CError = _bus ? _bus->_i2cWire->endTransmission() : 4;
 #else
     PCA9685_i2c_stop(); // Manually have to send stop bit in software i2c mode
-    return (_lastI2CError = 0);
+    _lastI2CError = 0;
+#endif
+
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    _stats.endTransmissionMicros += micros() - beginMicros;
+    _stats.transactions++;
+    switch (_lastI2CError) {
+        case 0: break;
+        case 1: _stats.dataTooLongErrors++; break;
+        case 2: _stats.addressNacks++; break;
+        case 3: _stats.dataNacks++; break;
+        default: _stats.otherErrors++; break;
+    }
+#endif
+
+#ifdef PCA9685_ENABLE_TRACE
+    traceEvent(PCA9685_TraceOp_TransmissionEnd, 0, _txBytes, 0, _lastI2CError);
+#endif
+
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+#ifndef PCA9685_USE_SOFTWARE_I2C
+    PCA9685_BusProfiler::record(_bus ? _bus->_i2cWire : NULL, _txI2CAddress, _txBytes, getI2CSpeed(), micros() - _txBeginMicros);
+#else
+    PCA9685_BusProfiler::record(NULL, _txI2CAddress, _txBytes, getI2CSpeed(), micros() - _txBeginMicros);
 #endif
+#endif
+
+    return _lastI2CError;
 }
 
 uint8_t PCA9685::i2cWire_requestFrom(uint8_t addr, uint8_t len) {
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+    unsigned long beginMicros = micros();
+#endif
+
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    return _i2cWire->requestFrom(addr, (size_t)len);
+    uint8_t retVal = _bus ? _bus->_i2cWire->requestFrom(addr, (size_t)len) : 0;
 #else
     i2c_start(addr | 0x01);
-    return (_readBytes = len);
+    uint8_t retVal = (_readBytes = len);
+#endif
+
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    _stats.reads++;
+    if (retVal != len) _stats.otherErrors++;
+#endif
+
+#ifdef PCA9685_ENABLE_TRACE
+    _txI2CAddress = addr;
+    traceEvent(PCA9685_TraceOp_ReadRequest, 0, len, retVal, retVal != len ? 4 : 0);
+#endif
+
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+#ifndef PCA9685_USE_SOFTWARE_I2C
+    PCA9685_BusProfiler::record(_bus ? _bus->_i2cWire : NULL, addr, retVal, getI2CSpeed(), micros() - beginMicros);
+#else
+    PCA9685_BusProfiler::record(NULL, addr, retVal, getI2CSpeed(), micros() - beginMicros);
+#endif
 #endif
+
+    return retVal;
 }
 
 size_t PCA9685::i2cWire_write(uint8_t data) {
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    return _i2cWire->write(data);
+    size_t retVal = _bus ? _bus->_i2cWire->write(data) : 0;
 #else
-    return (size_t)PCA9685_i2c_write(data);
+    size_t retVal = (size_t)PCA9685_i2c_write(data);
+#endif
+
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    _stats.bytesWritten += retVal;
 #endif
+
+#if defined(PCA9685_ENABLE_TRACE) || defined(PCA9685_ENABLE_BUS_PROFILER)
+    _txBytes += retVal;
+#endif
+
+    return retVal;
 }
 
 uint8_t PCA9685::i2cWire_read(void) {
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    _stats.bytesRead++;
+#endif
+
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    return (uint8_t)(_i2cWire->read() & 0xFF);
+    return _bus ? (uint8_t)(_bus->_i2cWire->read() & 0xFF) : 0;
 #else
     if (_readBytes > 1) {
         _readBytes -= 1;
@@ -838,21 +1657,22 @@ uint8_t PCA9685::i2cWire_read(void) {
 
 int PCA9685::getWireInterfaceNumber() {
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    if (_i2cWire == &Wire) return 0;
+    if (!_bus) return -1;
+    if (_bus->_i2cWire == &Wire) return 0;
 #if WIRE_INTERFACES_COUNT > 1
-    if (_i2cWire == &Wire1) return 1;
+    if (_bus->_i2cWire == &Wire1) return 1;
 #endif
 #if WIRE_INTERFACES_COUNT > 2
-    if (_i2cWire == &Wire2) return 2;
+    if (_bus->_i2cWire == &Wire2) return 2;
 #endif
 #if WIRE_INTERFACES_COUNT > 3
-    if (_i2cWire == &Wire3) return 3;
+    if (_bus->_i2cWire == &Wire3) return 3;
 #endif
 #if WIRE_INTERFACES_COUNT > 4
-    if (_i2cWire == &Wire4) return 4;
+    if (_bus->_i2cWire == &Wire4) return 4;
 #endif
 #if WIRE_INTERFACES_COUNT > 5
-    if (_i2cWire == &Wire5) return 5;
+    if (_bus->_i2cWire == &Wire5) return 5;
 #endif
 #endif // /ifndef PCA9685_USE_SOFTWARE_I2C
     return -1;
@@ -886,12 +1706,18 @@ void PCA9685::printModuleInfo() {
     Serial.print(roundf(getI2CSpeed() / 1000.0f)); Serial.println("kHz");
 
     Serial.println(""); Serial.print("Phase Balancer: ");
-    Serial.print(_phaseBalancer); Serial.print(": ");
-    switch (_phaseBalancer) {
+    Serial.print(getPhaseBalancer()); Serial.print(": ");
+    switch (getPhaseBalancer()) {
         case PCA9685_PhaseBalancer_None:
             Serial.println("PCA9685_PhaseBalancer_None"); break;
         case PCA9685_PhaseBalancer_Linear:
             Serial.println("PCA9685_PhaseBalancer_Linear"); break;
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+        case PCA9685_PhaseBalancer_Packed:
+            Serial.println("PCA9685_PhaseBalancer_Packed"); break;
+        case PCA9685_PhaseBalancer_Custom:
+            Serial.println("PCA9685_PhaseBalancer_Custom"); break;
+#endif
         case PCA9685_PhaseBalancer_Count:
         case PCA9685_PhaseBalancer_Undefined:
             Serial.println(""); break;
@@ -938,6 +1764,12 @@ void PCA9685::printModuleInfo() {
             Serial.print(" PCA9685_MODE2_OCH_ONACK");
         Serial.println("");
 
+        Serial.println(""); Serial.println("PreScale Register:");
+        const byte preScaleReg = readRegister(PCA9685_PRESCALE_REG);
+        Serial.print("0x"); Serial.print(preScaleReg, HEX);
+        Serial.print(", Oscillator: "); Serial.print(_oscFrequency); Serial.print("Hz");
+        Serial.print(", PWM Frequency: "); Serial.print(_oscFrequency / (4096.0f * (preScaleReg + 1))); Serial.println("Hz");
+
         Serial.println(""); Serial.println("SubAddress1 Register:");
         const byte subAdr1Reg = readRegister(PCA9685_SUBADR1_REG);
         Serial.print("0x"); Serial.println(subAdr1Reg, HEX);
@@ -984,96 +1816,1875 @@ void PCA9685::checkForErrors() {
 
 #endif // /ifdef PCA9685_ENABLE_DEBUG_OUTPUT
 
-PCA9685_ServoEval::PCA9685_ServoEval(uint16_t minPWMAmount, uint16_t maxPWMAmount)
-    : _coeff(NULL), _isCSpline(false)
-{
-    minPWMAmount = min(minPWMAmount, PCA9685_PWM_FULL);
-    maxPWMAmount = constrain(maxPWMAmount, minPWMAmount, PCA9685_PWM_FULL);
+#ifndef PCA9685_USE_SOFTWARE_I2C
 
-    _coeff = new float[2];
-    _isCSpline = false;
+PCA9685_Bus PCA9685_Bus::_sharedBuses[PCA9685_MAX_SHARED_BUSES];
 
-    _coeff[0] = minPWMAmount;
-    _coeff[1] = (maxPWMAmount - minPWMAmount) / 180.0f;
-}
+PCA9685_Bus *PCA9685_Bus::getSharedBus(TwoWire& i2cWire, uint32_t i2cSpeed) {
+    PCA9685_Bus *freeBus = NULL;
 
-PCA9685_ServoEval::PCA9685_ServoEval(uint16_t minPWMAmount, uint16_t midPWMAmount, uint16_t maxPWMAmount)
-    : _coeff(NULL), _isCSpline(false)
-{
-    minPWMAmount = min(minPWMAmount, PCA9685_PWM_FULL);
-    midPWMAmount = constrain(midPWMAmount, minPWMAmount, PCA9685_PWM_FULL);
-    maxPWMAmount = constrain(maxPWMAmount, midPWMAmount, PCA9685_PWM_FULL);
-
-    if (maxPWMAmount - midPWMAmount != midPWMAmount - minPWMAmount) {
-        _coeff = new float[8];
-        _isCSpline = true;
-
-        // Cubic spline code adapted from: https://shiftedbits.org/2011/01/30/cubic-spline-interpolation/
-        /* "THE BEER-WARE LICENSE" (Revision 42): Devin Lane wrote this [part]. As long as you retain
-        * this notice you can do whatever you want with this stuff. If we meet some day, and you
-        * think this stuff is worth it, you can buy me a beer in return. */
-       // TODO: Looks like I owe Devin Lane a beer. -NR
-
-        float x[3] = { 0, 90, 180 };
-        float y[3] = { (float)minPWMAmount, (float)midPWMAmount, (float)maxPWMAmount };
-        float c[3], b[2], d[2], h[2], l[1], u[2], a[1], z[2]; // n = 3
-
-        h[0] = x[1] - x[0];
-        u[0] = z[0] = 0;
-        c[2] = 0;
-
-        for (int i = 1; i < 2; ++i) {
-            h[i] = x[i + 1] - x[i];
-            l[i - 1] = (2 * (x[i + 1] - x[i - 1])) - h[i - 1] * u[i - 1];
-            u[i] = h[i] / l[i - 1];
-            a[i - 1] = (3 / h[i]) * (y[i + 1] - y[i]) - (3 / h[i - 1]) * (y[i] - y[i - 1]);
-            z[i] = (a[i - 1] - h[i - 1] * z[i - 1]) / l[i - 1];
+    for (int index = 0; index < PCA9685_MAX_SHARED_BUSES; ++index) {
+        PCA9685_Bus *bus = &_sharedBuses[index];
+        if (!bus->_refCount) {
+            if (!freeBus) freeBus = bus;
         }
-
-        for (int i = 1; i >= 0; --i) {
-            c[i] = z[i] - u[i] * c[i + 1];
-            b[i] = (y[i + 1] - y[i]) / h[i] - (h[i] * (c[i + 1] + 2 * c[i])) / 3;
-            d[i] = (c[i + 1] - c[i]) / (3 * h[i]);
-
-            _coeff[4 * i + 0] = y[i]; // a
-            _coeff[4 * i + 1] = b[i]; // b
-            _coeff[4 * i + 2] = c[i]; // c
-            _coeff[4 * i + 3] = d[i]; // d
+        else if (bus->_i2cWire == &i2cWire && bus->_i2cSpeed == i2cSpeed) {
+            return bus;
         }
     }
-    else {
-        _coeff = new float[2];
-        _isCSpline = false;
 
-        _coeff[0] = minPWMAmount;
-        _coeff[1] = (maxPWMAmount - minPWMAmount) / 180.0f;
+    if (freeBus) {
+        freeBus->_i2cWire = &i2cWire;
+        freeBus->_i2cSpeed = i2cSpeed;
+        freeBus->_lastI2CError = 0;
+        return freeBus;
     }
-}
 
-PCA9685_ServoEval::~PCA9685_ServoEval() {
-    if (_coeff) { delete[] _coeff; _coeff = NULL; }
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+    Serial.println("  PCA9685_Bus::getSharedBus Shared bus pool full, raise PCA9685_MAX_SHARED_BUSES");
+#endif
+    assert(false && "Shared bus pool full, raise PCA9685_MAX_SHARED_BUSES");
+
+    // Sharing a bus of another Wire instance or speed would drive the module wrongly
+    return NULL;
 }
 
-uint16_t PCA9685_ServoEval::pwmForAngle(float angle) {
-    float retVal;
+void PCA9685_Bus::resetDevices() {
+    begin();
+
+    _i2cWire->beginTransmission(0x00);
+    _i2cWire->write(PCA9685_SW_RESET);
+    _lastI2CError = _i2cWire->endTransmission();
+
+    delayMicroseconds(10);
+}
+
+uint32_t PCA9685_Bus::getI2CSpeed() {
+    return _i2cSpeed;
+}
+
+byte PCA9685_Bus::getLastI2CError() {
+    return _lastI2CError;
+}
+
+void PCA9685_Device::init(PCA9685_Bus &bus,
+                          PCA9685_OutputDriverMode driverMode,
+                          PCA9685_OutputEnabledMode enabledMode,
+                          PCA9685_OutputDisabledMode disabledMode,
+                          PCA9685_ChannelUpdateMode updateMode,
+                          PCA9685_PhaseBalancer phaseBalancer) {
+    assert(!(driverMode == PCA9685_OutputDriverMode_OpenDrain && disabledMode == PCA9685_OutputDisabledMode_High && "Unsupported combination"));
+    assert((phaseBalancer == PCA9685_PhaseBalancer_None || phaseBalancer == PCA9685_PhaseBalancer_Linear) && "Unsupported phase balancer");
+
+    _driverMode = driverMode;
+    _enabledMode = enabledMode;
+    _disabledMode = disabledMode;
+    _updateMode = updateMode;
+    _phaseBalancer = phaseBalancer == PCA9685_PhaseBalancer_Linear;
+
+    Module module = getModule(bus);
+    module.begin();
+    PCA9685_Core::writeModes(module, PCA9685_Detail::getMode2Value(driverMode, enabledMode, disabledMode, updateMode));
+}
+
+byte PCA9685_Device::getI2CAddress() {
+    return _i2cAddress;
+}
+
+PCA9685_OutputDriverMode PCA9685_Device::getOutputDriverMode() {
+    return (PCA9685_OutputDriverMode)_driverMode;
+}
+
+PCA9685_OutputEnabledMode PCA9685_Device::getOutputEnabledMode() {
+    return (PCA9685_OutputEnabledMode)_enabledMode;
+}
+
+PCA9685_OutputDisabledMode PCA9685_Device::getOutputDisabledMode() {
+    return (PCA9685_OutputDisabledMode)_disabledMode;
+}
+
+PCA9685_ChannelUpdateMode PCA9685_Device::getChannelUpdateMode() {
+    return (PCA9685_ChannelUpdateMode)_updateMode;
+}
+
+PCA9685_PhaseBalancer PCA9685_Device::getPhaseBalancer() {
+    return _phaseBalancer ? PCA9685_PhaseBalancer_Linear : PCA9685_PhaseBalancer_None;
+}
+
+void PCA9685_Device::setPWMFrequency(PCA9685_Bus &bus, float pwmFrequency) {
+    if (pwmFrequency <= 0) return;
+
+    setPWMFrequencyQ4(bus, PCA9685_Detail::getPWMFrequencyQ4(pwmFrequency));
+}
+
+void PCA9685_Device::setPWMFrequencyQ4(PCA9685_Bus &bus, uint16_t pwmFrequencyQ4) {
+    if (pwmFrequencyQ4 == 0) return;
+
+    Module module = getModule(bus);
+    PCA9685_Core::writePreScaler(module, PCA9685_Detail::getPreScalerValue(PCA9685_OSC_FREQUENCY, pwmFrequencyQ4));
+}
+
+void PCA9685_Device::setPWMFreqServo(PCA9685_Bus &bus) {
+    setPWMFrequencyQ4(bus, 50 << 4);
+}
+
+void PCA9685_Device::setChannelOn(PCA9685_Bus &bus, int channel) {
+    if (channel < 0 || channel > 15) return;
+
+    Module module = getModule(bus);
+    PCA9685_Core::writeChannelPhase(module, PCA9685_LED0_REG + (channel << 2), PCA9685_PWM_FULL, 0);  // time_on = FULL; time_off = 0;
+}
+
+void PCA9685_Device::setChannelOff(PCA9685_Bus &bus, int channel) {
+    if (channel < 0 || channel > 15) return;
+
+    Module module = getModule(bus);
+    PCA9685_Core::writeChannelPhase(module, PCA9685_LED0_REG + (channel << 2), 0, PCA9685_PWM_FULL);  // time_on = 0; time_off = FULL;
+}
+
+void PCA9685_Device::setChannelPWM(PCA9685_Bus &bus, int channel, uint16_t pwmAmount) {
+    setChannelsPWM(bus, channel, 1, &pwmAmount);
+}
+
+void PCA9685_Device::setChannelsPWM(PCA9685_Bus &bus, int begChannel, int numChannels, const uint16_t *pwmAmounts) {
+    if (begChannel < 0 || begChannel > 15 || numChannels < 0) return;
+    if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
+
+    Module module = getModule(bus);
+    PCA9685_Core::writeChannelsPWM(module, begChannel, numChannels, pwmAmounts, (PCA9685_I2C_BUFFER_LENGTH - 1) / 4);
+}
+
+void PCA9685_Device::setAllChannelsPWM(PCA9685_Bus &bus, uint16_t pwmAmount) {
+    Module module = getModule(bus);
+    uint16_t phaseBegin, phaseEnd;
+    module.prepareChannelPWM(PCA9685_ALLLED_CHANNEL, pwmAmount, &phaseBegin, &phaseEnd);
+    PCA9685_Core::writeChannelPhase(module, PCA9685_ALLLED_REG, phaseBegin, phaseEnd);
+}
+
+uint16_t PCA9685_Device::getChannelPWM(PCA9685_Bus &bus, int channel) {
+    if (channel < 0 || channel > 15) return 0;
+    return getModule(bus).readChannelPWM(channel);
+}
+
+#endif // /ifndef PCA9685_USE_SOFTWARE_I2C
+
+// Fixed-point servo evaluation works over a normalized segment position t (Q12, 0 to
+// 4096) with coefficients in Q4 PWM units, so that every Horner step fits into 32 bits.
+#define PCA9685_SERVOEVAL_LINEAR_TSCALE     (uint32_t)5826      // (4096 << 16) / (180 << 8), rounded up
+
+void PCA9685_ServoEval::initCSpline(const float *angles, const uint16_t *pwmAmounts, int numPoints) {
+    CSpline cspline = CSpline();
+    float x[PCA9685_SERVOEVAL_MAX_POINTS], y[PCA9685_SERVOEVAL_MAX_POINTS];
+    int n = numPoints;
+
+    // Calibration points are constrained to be increasing in PWM value, same as the 3 point
+    // constructor does, but angles that aren't strictly increasing can't be made so, and
+    // are instead rejected, leaving the evaluator as constructed (outputting full off).
+    for (int i = 0; i < n; ++i) {
+        uint16_t knotQ8;
+        if (angles) {
+            knotQ8 = (uint16_t)roundf((constrain(angles[i], -90.0f, 90.0f) + 90.0f) * 256.0f);
+        } else {
+            knotQ8 = (uint16_t)(((180UL << 8) * i) / (n - 1));
+        }
+        if (i && knotQ8 <= cspline.knotsQ8[i - 1]) {
+#ifdef PCA9685_ENABLE_DEBUG_OUTPUT
+            Serial.print("PCA9685_ServoEval::initCSpline Calibration angle not strictly increasing at point: ");
+            Serial.println(i);
+#endif
+            assert(false && "Calibration angles must be strictly increasing");
+            return;
+        }
+
+        uint16_t pwmAmount = min(pwmAmounts[i], PCA9685_PWM_FULL);
+        if (i && pwmAmount < (uint16_t)y[i - 1]) pwmAmount = (uint16_t)y[i - 1];
+
+        cspline.knotsQ8[i] = knotQ8;
+        x[i] = knotQ8 / 256.0f;
+        y[i] = pwmAmount;
+    }
+
+    _isCSpline = true;
+    _isUniform = !angles;
+    _numSegments = n - 1;
+    _segmentScale = ((uint32_t)_numSegments << 24) / (180UL << 8);
+
+    // Cubic spline code adapted from: https://shiftedbits.org/2011/01/30/cubic-spline-interpolation/
+    /* "THE BEER-WARE LICENSE" (Revision 42): Devin Lane wrote this [part]. As long as you retain
+    * this notice you can do whatever you want with this stuff. If we meet some day, and you
+    * think this stuff is worth it, you can buy me a beer in return. */
+   // TODO: Looks like I owe Devin Lane a beer. -NR
+
+    float c[PCA9685_SERVOEVAL_MAX_POINTS], h[PCA9685_SERVOEVAL_MAX_POINTS - 1];
+    float u[PCA9685_SERVOEVAL_MAX_POINTS - 1], z[PCA9685_SERVOEVAL_MAX_POINTS - 1];
+
+    h[0] = x[1] - x[0];
+    u[0] = z[0] = 0;
+    c[n - 1] = 0;
+
+    for (int i = 1; i < n - 1; ++i) {
+        h[i] = x[i + 1] - x[i];
+        float l = (2 * (x[i + 1] - x[i - 1])) - h[i - 1] * u[i - 1];
+        u[i] = h[i] / l;
+        float a = (3 / h[i]) * (y[i + 1] - y[i]) - (3 / h[i - 1]) * (y[i] - y[i - 1]);
+        z[i] = (a - h[i - 1] * z[i - 1]) / l;
+    }
+
+    for (int i = n - 2; i >= 0; --i) {
+        c[i] = z[i] - u[i] * c[i + 1];
+        float b = (y[i + 1] - y[i]) / h[i] - (h[i] * (c[i + 1] + 2 * c[i])) / 3;
+        float d = (c[i + 1] - c[i]) / (3 * h[i]);
+
+        cspline.coeff[4 * i + 0] = y[i]; // a
+        cspline.coeff[4 * i + 1] = b;    // b
+        cspline.coeff[4 * i + 2] = c[i]; // c
+        cspline.coeff[4 * i + 3] = d;    // d
+
+        // Same polynomial, but re-expressed over t = (angle - x[i]) / h[i] (0 to 1)
+        cspline.coeffQ[4 * i + 0] = roundQ4(y[i]);                      // A
+        cspline.coeffQ[4 * i + 1] = roundQ4(b * h[i]);                  // B
+        cspline.coeffQ[4 * i + 2] = roundQ4(c[i] * h[i] * h[i]);        // C
+        cspline.coeffQ[4 * i + 3] = roundQ4(d * h[i] * h[i] * h[i]);    // D
+
+        uint16_t hQ8 = cspline.knotsQ8[i + 1] - cspline.knotsQ8[i];
+        cspline.tScales[i] = ((4096UL << 16) + hQ8 - 1) / hQ8;
+    }
+
+    _coeffs.cspline = cspline;
+}
+
+int PCA9685_ServoEval::findSegment(uint16_t angleQ8) const {
+    const uint16_t *knotsQ8 = _coeffs.cspline.knotsQ8;
+    int segment;
+
+    if (_isUniform) {
+        // Direct indexing, corrected for any rounding in segment scaler or knot placement
+        segment = (int)(((uint32_t)angleQ8 * _segmentScale) >> 24);
+        if (segment >= _numSegments) segment = _numSegments - 1;
+        if (segment > 0 && angleQ8 < knotsQ8[segment]) --segment;
+        else if (segment + 1 < _numSegments && angleQ8 >= knotsQ8[segment + 1]) ++segment;
+    }
+    else {
+        int lower = 0, upper = _numSegments - 1;
+        while (lower < upper) {
+            int middle = (lower + upper + 1) >> 1;
+            if (knotsQ8[middle] <= angleQ8) lower = middle;
+            else upper = middle - 1;
+        }
+        segment = lower;
+    }
+
+    return segment;
+}
+
+uint16_t PCA9685_ServoEval::pwmForAngle(float angle) const {
+    float retVal;
     angle = constrain(angle + 90, 0, 180);
 
     if (!_isCSpline) {
-        retVal = _coeff[0] + (_coeff[1] * angle);
+        retVal = _coeffs.linear.coeff[0] + (_coeffs.linear.coeff[1] * angle);
+    }
+    else {
+        const uint16_t *knotsQ8 = _coeffs.cspline.knotsQ8;
+        uint16_t angleQ8 = constrain((uint16_t)(angle * 256.0f), knotsQ8[0], knotsQ8[_numSegments]);
+        int segment = findSegment(angleQ8);
+        const float *coeff = &_coeffs.cspline.coeff[4 * segment];
+
+        angle = constrain(angle, knotsQ8[0] / 256.0f, knotsQ8[_numSegments] / 256.0f);
+        angle -= knotsQ8[segment] / 256.0f;
+        retVal = coeff[0] + (coeff[1] * angle) + (coeff[2] * angle * angle) + (coeff[3] * angle * angle * angle);
+    }
+
+    return (uint16_t)constrain(roundf(retVal), 0, (float)PCA9685_PWM_FULL);
+};
+
+uint16_t PCA9685_ServoEval::pwmForSpeed(float speed) const {
+    return pwmForAngle(speed * 90.0f);
+}
+
+uint16_t PCA9685_ServoEval::pwmForAngleQ8(int16_t angleQ8) const {
+    int32_t retValQ4;
+    uint16_t angle = (uint16_t)(constrain((int32_t)angleQ8, -(90L << 8), 90L << 8) + (90L << 8)); // 0 to 180 << 8
+
+    if (!_isCSpline) {
+        int32_t t = (int32_t)((angle * PCA9685_SERVOEVAL_LINEAR_TSCALE) >> 16);
+        retValQ4 = _coeffs.linear.coeffQ[0] + ((_coeffs.linear.coeffQ[1] * t) >> 12);
+    }
+    else {
+        const uint16_t *knotsQ8 = _coeffs.cspline.knotsQ8;
+        angle = constrain(angle, knotsQ8[0], knotsQ8[_numSegments]);
+        int segment = findSegment(angle);
+        const int32_t *coeffQ = &_coeffs.cspline.coeffQ[4 * segment];
+
+        int32_t t = (int32_t)(((uint32_t)(angle - knotsQ8[segment]) * _coeffs.cspline.tScales[segment]) >> 16);
+        retValQ4 = coeffQ[3];
+        retValQ4 = coeffQ[2] + ((retValQ4 * t) >> 12);
+        retValQ4 = coeffQ[1] + ((retValQ4 * t) >> 12);
+        retValQ4 = coeffQ[0] + ((retValQ4 * t) >> 12);
+    }
+
+    retValQ4 = (retValQ4 + 8) >> 4;
+    return (uint16_t)constrain(retValQ4, 0, (int32_t)PCA9685_PWM_FULL);
+}
+
+uint16_t PCA9685_ServoEval::pwmForSpeedQ8(int16_t speedQ8) const {
+    return pwmForAngleQ8((int16_t)constrain((int32_t)speedQ8 * 90, -(90L << 8), 90L << 8));
+}
+
+float PCA9685_ServoEval::angleForPwm(uint16_t pwmAmount) const {
+    float retVal;
+
+    if (!_isCSpline) {
+        if (_coeffs.linear.coeff[1] <= 0.0f) return 0.0f;
+        retVal = (pwmAmount - _coeffs.linear.coeff[0]) / _coeffs.linear.coeff[1];
+        retVal = constrain(retVal, 0.0f, 180.0f);
     }
     else {
-        if (angle <= 90) {
-            retVal = _coeff[0] + (_coeff[1] * angle) + (_coeff[2] * angle * angle) + (_coeff[3] * angle * angle * angle);
+        const CSpline &cspline = _coeffs.cspline;
+        const float *coeff;
+
+        // Knot values are non-decreasing by construction, so segment can be found by a
+        // binary search on each segment's a coefficient (its value at its begin knot).
+        int lower = 0, upper = _numSegments - 1;
+        while (lower < upper) {
+            int middle = (lower + upper + 1) >> 1;
+            if (cspline.coeff[4 * middle] <= pwmAmount) lower = middle;
+            else upper = middle - 1;
+        }
+        coeff = &cspline.coeff[4 * lower];
+
+        float h = (cspline.knotsQ8[lower + 1] - cspline.knotsQ8[lower]) / 256.0f;
+        float endVal = coeff[0] + (coeff[1] * h) + (coeff[2] * h * h) + (coeff[3] * h * h * h);
+        float x;
+
+        if (pwmAmount <= coeff[0]) {
+            x = 0;
+        }
+        else if (pwmAmount >= endVal) {
+            x = h;
+        }
+        else {
+            // Initial guess from linear interpolation between segment end values, refined
+            // by Newton steps, kept within the segment in case of spline overshoot
+            x = h * (pwmAmount - coeff[0]) / (endVal - coeff[0]);
+
+            for (int step = 0; step < 4; ++step) {
+                float f = coeff[0] + (coeff[1] * x) + (coeff[2] * x * x) + (coeff[3] * x * x * x) - pwmAmount;
+                float df = coeff[1] + (2 * coeff[2] * x) + (3 * coeff[3] * x * x);
+                if (fabsf(f) < 0.01f || df <= 0.0f) break;
+                x = constrain(x - (f / df), 0.0f, h);
+            }
+        }
+
+        retVal = (cspline.knotsQ8[lower] / 256.0f) + x;
+    }
+
+    return retVal - 90.0f;
+}
+
+float PCA9685_ServoEval::speedForPwm(uint16_t pwmAmount) const {
+    return angleForPwm(pwmAmount) / 90.0f;
+}
+
+void PCA9685_ServoEval::pwmForAngles(const float *angles, uint16_t *pwmAmounts, int numAngles) const {
+    while (numAngles-- > 0) {
+        *pwmAmounts++ = pwmForAngle(*angles++);
+    }
+}
+
+void PCA9685_ServoEval::pwmForAngles(const int16_t *anglesQ8, uint16_t *pwmAmounts, int numAngles) const {
+    while (numAngles-- > 0) {
+        *pwmAmounts++ = pwmForAngleQ8(*anglesQ8++);
+    }
+}
+
+PCA9685_Ditherer::PCA9685_Ditherer(PCA9685& pwmController)
+    : _pwmController(&pwmController)
+{
+    memset(_targets, 0, sizeof(_targets));
+    memset(_errors, 0, sizeof(_errors));
+    invalidate();
+}
+
+void PCA9685_Ditherer::setChannelTarget(int channel, uint16_t targetAmount) {
+    if (channel < 0 || channel > 15) return;
+
+    _targets[channel] = targetAmount;
+}
+
+void PCA9685_Ditherer::setChannelsTarget(int begChannel, int numChannels, const uint16_t *targetAmounts) {
+    if (begChannel < 0 || begChannel > 15 || numChannels < 0) return;
+    if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
+
+    memcpy(&_targets[begChannel], targetAmounts, numChannels * sizeof(uint16_t));
+}
+
+uint16_t PCA9685_Ditherer::getChannelTarget(int channel) {
+    if (channel < 0 || channel > 15) return 0;
+
+    return _targets[channel];
+}
+
+void PCA9685_Ditherer::update() {
+    uint16_t changedChannels = 0;
+
+    // First-order error diffusion over time: the 4-bit remainder is accumulated every
+    // period, and whenever it overflows the next 12-bit code up is output instead.
+    for (int channel = 0; channel < 16; ++channel) {
+        uint16_t pwmCode = _targets[channel] >> 4;
+        byte error = _errors[channel] + (byte)(_targets[channel] & 0x0F);
+
+        if (_targets[channel] == 0xFFFF) {
+            // Would otherwise be 4095 one period in 16, rather than staying full on
+            pwmCode = PCA9685_PWM_FULL;
+            error = 0;
+        }
+        else if (error >= 16) {
+            error -= 16;
+            ++pwmCode; // may become 4096, which is full on
+        }
+        _errors[channel] = error;
+
+        if (pwmCode != _pwmCodes[channel]) {
+            _pwmCodes[channel] = pwmCode;
+            changedChannels |= (uint16_t)1 << channel;
+        }
+    }
+
+    // Only runs of changed channels are written, using the batched write path, so that
+    // bus load scales with how many channels are actually being dithered.
+    int begChannel = 0;
+    while (changedChannels) {
+        while (!(changedChannels & 0x01)) { changedChannels >>= 1; ++begChannel; }
+
+        int numChannels = 0;
+        while (changedChannels & 0x01) { changedChannels >>= 1; ++numChannels; }
+
+        _pwmController->setChannelsPWM(begChannel, numChannels, &_pwmCodes[begChannel]);
+        if (_pwmController->getLastI2CError()) {
+            invalidate(); // retry everything on next update
+            return;
+        }
+
+        begChannel += numChannels;
+    }
+}
+
+void PCA9685_Ditherer::invalidate() {
+    memset(_pwmCodes, 0xFF, sizeof(_pwmCodes));
+}
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+PCA9685_PhasePlanner::PCA9685_PhasePlanner(PCA9685 **pwmControllers, int numControllers)
+    : _pwmControllers(pwmControllers), _numControllers(numControllers)
+{ }
+
+void PCA9685_PhasePlanner::planLinear() {
+    uint32_t numChannels = getNumChannels();
+    if (!numChannels) return;
+
+    for (int controller = 0; controller < _numControllers; ++controller) {
+        uint16_t phaseOffsets[16];
+
+        for (int channel = 0; channel < 16; ++channel)
+            phaseOffsets[channel] = (uint16_t)((((uint32_t)controller * 16 + channel) * PCA9685_PWM_FULL) / numChannels);
+
+        _pwmControllers[controller]->setChannelsPhaseOffset(0, 16, phaseOffsets);
+    }
+}
+
+void PCA9685_PhasePlanner::planPacked(const uint16_t *pwmAmounts) {
+    uint16_t phaseBegin = 0;
+
+    for (int controller = 0; controller < _numControllers; ++controller) {
+        const uint16_t *controllerAmounts = pwmAmounts ? &pwmAmounts[controller * 16]
+                                                       : _pwmControllers[controller]->_pwmAmounts;
+        uint16_t phaseOffsets[16];
+
+        for (int channel = 0; channel < 16; ++channel) {
+            uint16_t pwmAmount = controllerAmounts[channel];
+            if (pwmAmount > PCA9685_PWM_FULL) pwmAmount = PCA9685_PWM_FULL;
+
+            phaseOffsets[channel] = phaseBegin;
+            phaseBegin = (phaseBegin + pwmAmount) & PCA9685_PWM_MASK;
+        }
+
+        _pwmControllers[controller]->setChannelsPhaseOffset(0, 16, phaseOffsets);
+    }
+}
+
+float PCA9685_PhasePlanner::getCurrentProfile(float *peakCurrents, int numBins, const float *channelCurrents) {
+    float retVal = 0;
+    if (numBins <= 0) return retVal;
+    if (numBins > PCA9685_PWM_FULL) numBins = PCA9685_PWM_FULL;
+
+    for (int bin = 0; bin < numBins; ++bin) {
+        uint16_t binBegin = (uint16_t)(((uint32_t)bin * PCA9685_PWM_FULL) / numBins);
+        uint16_t binEnd = (uint16_t)(((uint32_t)(bin + 1) * PCA9685_PWM_FULL) / numBins);
+
+        // Current is constant between edges, and only ever rises at a leading edge, so
+        // the peak within a bin is found either at its start or at a leading edge in it.
+        float binPeak = getCurrentAt(binBegin, channelCurrents);
+
+        for (int controller = 0; controller < _numControllers; ++controller) {
+            PCA9685 *pwmController = _pwmControllers[controller];
+
+            for (int channel = 0; channel < 16; ++channel) {
+                uint16_t pwmAmount = pwmController->_pwmAmounts[channel];
+                uint16_t phaseBegin = pwmController->_phaseBegins[channel] & PCA9685_PWM_MASK;
+
+                if (pwmAmount > 0 && pwmAmount < PCA9685_PWM_FULL && phaseBegin > binBegin && phaseBegin < binEnd) {
+                    float current = getCurrentAt(phaseBegin, channelCurrents);
+                    if (current > binPeak) binPeak = current;
+                }
+            }
+        }
+
+        if (peakCurrents) peakCurrents[bin] = binPeak;
+        if (binPeak > retVal) retVal = binPeak;
+    }
+
+    return retVal;
+}
+
+int PCA9685_PhasePlanner::getNumChannels() {
+    return _numControllers * 16;
+}
+
+float PCA9685_PhasePlanner::getCurrentAt(uint16_t phasePosition, const float *channelCurrents) {
+    float retVal = 0;
+
+    for (int controller = 0; controller < _numControllers; ++controller) {
+        PCA9685 *pwmController = _pwmControllers[controller];
+
+        for (int channel = 0; channel < 16; ++channel) {
+            uint16_t pwmAmount = pwmController->_pwmAmounts[channel];
+            // Unknown phase begins (e.g. after an i2c error) are treated as unshifted
+            uint16_t phaseBegin = pwmController->_phaseBegins[channel] & PCA9685_PWM_MASK;
+
+            if (pwmAmount >= PCA9685_PWM_FULL ||
+                (pwmAmount > 0 && ((phasePosition - phaseBegin) & PCA9685_PWM_MASK) < pwmAmount))
+                retVal += channelCurrents ? channelCurrents[controller * 16 + channel] : 1.0f;
+        }
+    }
+
+    return retVal;
+}
+
+#endif // /ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+// Frame parser states
+#define PCA9685_FRAME_STATE_START           0
+#define PCA9685_FRAME_STATE_ADDRESS         1
+#define PCA9685_FRAME_STATE_CHANNEL         2
+#define PCA9685_FRAME_STATE_COUNT           3
+#define PCA9685_FRAME_STATE_PAYLOAD         4
+#define PCA9685_FRAME_STATE_CRC             5
+
+PCA9685_FrameParser::PCA9685_FrameParser(PCA9685 **pwmControllers, int numControllers)
+    : _pwmControllers(pwmControllers), _numControllers(numControllers), _pwmController(NULL),
+      _state(PCA9685_FRAME_STATE_START), _crc(0), _begChannel(0), _numChannels(0), _numValues(0),
+      _payloadIndex(0), _nextValue(0), _pwmAmounts(), _framesCommitted(0), _framesDropped(0)
+{ }
+
+PCA9685_FrameStatus PCA9685_FrameParser::feed(byte data) {
+    if (_state != PCA9685_FRAME_STATE_START && _state != PCA9685_FRAME_STATE_CRC)
+        _crc = updateCRC(_crc, data);
+
+    switch (_state) {
+        case PCA9685_FRAME_STATE_START:
+            if (data == PCA9685_FRAME_START) {
+                _crc = 0;
+                _state = PCA9685_FRAME_STATE_ADDRESS;
+            }
+            return PCA9685_FrameStatus_Incomplete;
+
+        case PCA9685_FRAME_STATE_ADDRESS:
+            _pwmController = NULL;
+            for (int controller = 0; controller < _numControllers; ++controller) {
+                if ((_pwmControllers[controller]->getI2CAddress() & PCA9685_I2C_BASE_MODULE_ADRMASK) == (data & PCA9685_I2C_BASE_MODULE_ADRMASK)) {
+                    _pwmController = _pwmControllers[controller];
+                    break;
+                }
+            }
+            _state = PCA9685_FRAME_STATE_CHANNEL;
+            return PCA9685_FrameStatus_Incomplete;
+
+        case PCA9685_FRAME_STATE_CHANNEL:
+            _begChannel = data;
+            _state = PCA9685_FRAME_STATE_COUNT;
+            return PCA9685_FrameStatus_Incomplete;
+
+        case PCA9685_FRAME_STATE_COUNT:
+            _numChannels = data;
+            if (_begChannel > 15 || _numChannels < 1 || _begChannel + _numChannels > 16) {
+                _state = PCA9685_FRAME_STATE_START;
+                _framesDropped++;
+                return PCA9685_FrameStatus_FormatError;
+            }
+            _numValues = 0; // Frames to unknown modules still get decoded, to be skipped over
+            _payloadIndex = 0;
+            _state = PCA9685_FRAME_STATE_PAYLOAD;
+            return PCA9685_FrameStatus_Incomplete;
+
+        case PCA9685_FRAME_STATE_PAYLOAD:
+            switch (_payloadIndex) {
+                case 0:
+                    _nextValue = data;
+                    _payloadIndex = 1;
+                    break;
+                case 1:
+                    _pwmAmounts[_numValues++] = _nextValue | ((uint16_t)(data & 0x0F) << 8);
+                    _nextValue = data >> 4;
+                    _payloadIndex = 2;
+                    break;
+                case 2:
+                    _pwmAmounts[_numValues++] = _nextValue | ((uint16_t)data << 4);
+                    _payloadIndex = 0;
+                    break;
+            }
+            if (_numValues >= _numChannels)
+                _state = PCA9685_FRAME_STATE_CRC;
+            return PCA9685_FrameStatus_Incomplete;
+
+        case PCA9685_FRAME_STATE_CRC:
+            _state = PCA9685_FRAME_STATE_START;
+            return endFrame(data == _crc);
+    }
+
+    return PCA9685_FrameStatus_Incomplete;
+}
+
+int PCA9685_FrameParser::feed(Stream &input) {
+    int retVal = 0;
+
+    while (input.available() > 0) {
+        if (feed((byte)input.read()) == PCA9685_FrameStatus_Committed)
+            ++retVal;
+    }
+
+    return retVal;
+}
+
+uint32_t PCA9685_FrameParser::getFramesCommitted() {
+    return _framesCommitted;
+}
+
+uint32_t PCA9685_FrameParser::getFramesDropped() {
+    return _framesDropped;
+}
+
+PCA9685_FrameStatus PCA9685_FrameParser::endFrame(bool crcValid) {
+    if (!crcValid || !_pwmController) {
+        _framesDropped++;
+        return !crcValid ? PCA9685_FrameStatus_CRCError : PCA9685_FrameStatus_UnknownDevice;
+    }
+
+    // As 12 bits can't hold 4096, 4095 is taken as full on
+    for (int index = 0; index < _numChannels; ++index) {
+        if (_pwmAmounts[index] == PCA9685_PWM_MASK)
+            _pwmAmounts[index] = PCA9685_PWM_FULL;
+    }
+
+    _pwmController->setChannelsPWM(_begChannel, _numChannels, _pwmAmounts);
+
+    _framesCommitted++;
+    return PCA9685_FrameStatus_Committed;
+}
+
+int PCA9685_FrameParser::encodeFrame(byte *buffer, byte i2cAddress, int begChannel, int numChannels, const uint16_t *pwmAmounts) {
+    if (begChannel < 0 || begChannel > 15 || numChannels < 1 || begChannel + numChannels > 16) return 0;
+
+    byte *out = buffer;
+    *out++ = PCA9685_FRAME_START;
+    *out++ = i2cAddress & PCA9685_I2C_BASE_MODULE_ADRMASK;
+    *out++ = (byte)begChannel;
+    *out++ = (byte)numChannels;
+
+    for (int index = 0; index < numChannels; index += 2) {
+        uint16_t value0 = pwmAmounts[index] < PCA9685_PWM_MASK ? pwmAmounts[index] : PCA9685_PWM_MASK;
+        *out++ = lowByte(value0);
+        if (index + 1 < numChannels) {
+            uint16_t value1 = pwmAmounts[index + 1] < PCA9685_PWM_MASK ? pwmAmounts[index + 1] : PCA9685_PWM_MASK;
+            *out++ = (byte)((value0 >> 8) | ((value1 & 0x0F) << 4));
+            *out++ = (byte)(value1 >> 4);
         }
         else {
-            angle -= 90;
-            retVal = _coeff[4] + (_coeff[5] * angle) + (_coeff[6] * angle * angle) + (_coeff[7] * angle * angle * angle);
+            *out++ = (byte)(value0 >> 8);
         }
     }
 
-    return (uint16_t)min((uint16_t)roundf(retVal), PCA9685_PWM_FULL);
+    byte crc = 0;
+    for (byte *in = buffer + 1; in < out; ++in)
+        crc = updateCRC(crc, *in);
+    *out++ = crc;
+
+    return (int)(out - buffer);
+}
+
+byte PCA9685_FrameParser::updateCRC(byte crc, byte data) {
+    crc ^= data;
+    for (int bit = 0; bit < 8; ++bit)
+        crc = (crc & 0x80) ? (byte)((crc << 1) ^ 0x07) : (byte)(crc << 1);
+    return crc;
+}
+
+// DMX gamma 2.2 table, from 8-bit level to PWM amount (round(4096 * (level / 255)^2.2))
+#ifdef pgm_read_word
+static const uint16_t PCA9685_DMXGammaTable[256] PROGMEM = {
+#else
+static const uint16_t PCA9685_DMXGammaTable[256] = {
+#endif
+    0, 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 7, 8,
+    9, 11, 12, 14, 15, 17, 19, 21, 23, 25, 27, 29, 32, 34, 37, 40,
+    43, 46, 49, 52, 55, 59, 62, 66, 70, 73, 77, 82, 86, 90, 95, 99,
+    104, 109, 114, 119, 124, 129, 135, 140, 146, 152, 158, 164, 170, 176, 182, 189,
+    196, 202, 209, 216, 224, 231, 238, 246, 254, 261, 269, 277, 286, 294, 302, 311,
+    320, 329, 338, 347, 356, 365, 375, 385, 394, 404, 414, 424, 435, 445, 456, 467,
+    477, 489, 500, 511, 522, 534, 546, 557, 569, 582, 594, 606, 619, 631, 644, 657,
+    670, 684, 697, 710, 724, 738, 752, 766, 780, 795, 809, 824, 838, 853, 869, 884,
+    899, 915, 930, 946, 962, 978, 994, 1011, 1027, 1044, 1061, 1078, 1095, 1112, 1130, 1147,
+    1165, 1183, 1201, 1219, 1238, 1256, 1275, 1293, 1312, 1331, 1351, 1370, 1389, 1409, 1429, 1449,
+    1469, 1489, 1510, 1530, 1551, 1572, 1593, 1614, 1636, 1657, 1679, 1700, 1722, 1745, 1767, 1789,
+    1812, 1834, 1857, 1880, 1904, 1927, 1950, 1974, 1998, 2022, 2046, 2070, 2095, 2119, 2144, 2169,
+    2194, 2219, 2245, 2270, 2296, 2322, 2348, 2374, 2400, 2427, 2453, 2480, 2507, 2534, 2561, 2589,
+    2616, 2644, 2672, 2700, 2728, 2757, 2785, 2814, 2843, 2872, 2901, 2931, 2960, 2990, 3020, 3050,
+    3080, 3110, 3141, 3171, 3202, 3233, 3264, 3295, 3327, 3359, 3390, 3422, 3454, 3487, 3519, 3552,
+    3585, 3618, 3651, 3684, 3717, 3751, 3785, 3819, 3853, 3887, 3921, 3956, 3991, 4026, 4061, 4096
 };
 
-uint16_t PCA9685_ServoEval::pwmForSpeed(float speed) {
-    return pwmForAngle(speed * 90.0f);
+static inline uint16_t PCA9685_DMXGamma(uint16_t index) {
+#ifdef pgm_read_word
+    return pgm_read_word(&PCA9685_DMXGammaTable[index]);
+#else
+    return PCA9685_DMXGammaTable[index];
+#endif
+}
+
+#define PCA9685_DMX_UNKNOWN_AMOUNT      (uint16_t)0xFFFF    // Last amount of patch not yet (or not known to be) written
+
+PCA9685_DMXMapper::PCA9685_DMXMapper(PCA9685 **pwmControllers, int numControllers, const PCA9685_DMXPatch *patches, int numPatches, uint16_t *lastAmounts, bool patchesInProgmem)
+    : _pwmControllers(pwmControllers), _numControllers(numControllers), _patches(patches), _numPatches(numPatches), _lastAmounts(lastAmounts),
+      _patchesInProgmem(patchesInProgmem), _firstUpdate(true)
+{
+#ifndef PCA9685_ENABLE_CHANNEL_CACHE
+    assert(lastAmounts && "Last amounts buffer required without PCA9685_ENABLE_CHANNEL_CACHE");
+#endif
 }
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+PCA9685_DMXMapper::PCA9685_DMXMapper(PCA9685 **pwmControllers, int numControllers, const PCA9685_DMXPatch *patches, int numPatches, bool patchesInProgmem)
+    : PCA9685_DMXMapper(pwmControllers, numControllers, patches, numPatches, (uint16_t *)NULL, patchesInProgmem)
+{ }
+
+#endif
+
+int PCA9685_DMXMapper::update(const byte *universe, int universeLength) {
+    // Module may still hold amounts from before an MCU restart, which neither last amounts
+    // nor init's channel cache (all full off) know anything about, so first update writes
+    // out every patched channel. Done here rather than in constructor, which may run before
+    // controllers' init.
+    if (_firstUpdate) {
+        invalidate();
+        _firstUpdate = false;
+    }
+
+    int retVal = 0;
+    int controller = -1;
+    int begIndex = 0;
+    uint16_t patchedChannels = 0;
+    uint16_t changedChannels = 0;
+    uint16_t pwmAmounts[16];
+
+    for (int index = 0; index < _numPatches; ++index) {
+        PCA9685_DMXPatch patch;
+        readPatch(index, &patch);
+
+        bool is16Bit = patch.flags & PCA9685_DMX_16BIT;
+        if (patch.controller >= _numControllers || patch.channel > 15 ||
+            (int)patch.slot + (is16Bit ? 2 : 1) > universeLength) continue;
+
+        if (patch.controller != controller) {
+            // Patches are taken in given order, so module's changes go out as they end
+            if (patchedChannels)
+                retVal += flushChannels(controller, begIndex, index, patchedChannels, changedChannels, pwmAmounts);
+            controller = patch.controller;
+            begIndex = index;
+            patchedChannels = changedChannels = 0;
+        }
+
+        uint16_t level = is16Bit ? ((uint16_t)universe[patch.slot] << 8) | universe[patch.slot + 1] : universe[patch.slot];
+        uint16_t channelBit = (uint16_t)1 << patch.channel;
+        pwmAmounts[patch.channel] = pwmForLevel(level, patch.flags);
+        patchedChannels |= channelBit;
+
+        if (_lastAmounts && _lastAmounts[index] != pwmAmounts[patch.channel]) {
+            _lastAmounts[index] = pwmAmounts[patch.channel];
+            changedChannels |= channelBit;
+        }
+    }
+
+    if (patchedChannels)
+        retVal += flushChannels(controller, begIndex, _numPatches, patchedChannels, changedChannels, pwmAmounts);
+
+    return retVal;
+}
+
+void PCA9685_DMXMapper::invalidate() {
+    if (_lastAmounts) {
+        for (int index = 0; index < _numPatches; ++index)
+            _lastAmounts[index] = PCA9685_DMX_UNKNOWN_AMOUNT;
+    }
+    else {
+        for (int controller = 0; controller < _numControllers; ++controller)
+            _pwmControllers[controller]->invalidateChannelCache();
+    }
+}
+
+int PCA9685_DMXMapper::flushChannels(int controller, int begIndex, int endIndex, uint16_t patchedChannels, uint16_t changedChannels, const uint16_t *pwmAmounts) {
+    PCA9685 *pwmController = _pwmControllers[controller];
+
+    // Compared against channel cache only once module's patches are all in, as a later
+    // patch may retarget an earlier patch's channel
+    if (!_lastAmounts)
+        changedChannels = pwmController->getChangedChannels(patchedChannels, pwmAmounts);
+    if (!changedChannels) return 0;
+
+    int retVal = pwmController->setChangedChannelsPWM(changedChannels, pwmAmounts);
+
+    if (_lastAmounts && pwmController->getLastI2CError()) {
+        // Unknown what made it out, so module's patches get rewritten next update (channel
+        // cache already sees to this itself)
+        for (int index = begIndex; index < endIndex; ++index)
+            _lastAmounts[index] = PCA9685_DMX_UNKNOWN_AMOUNT;
+    }
+
+    return retVal;
+}
+
+uint16_t PCA9685_DMXMapper::pwmForLevel(uint16_t level, byte flags) {
+    if (!(flags & PCA9685_DMX_16BIT)) {
+        if (level > 255) level = 255;
+        if (flags & PCA9685_DMX_GAMMA)
+            return PCA9685_DMXGamma(level);
+        return (uint16_t)(((uint32_t)level * 4113) >> 8); // 255 -> 4096
+    }
+
+    if (!(flags & PCA9685_DMX_GAMMA))
+        return (uint16_t)(((uint32_t)level * 4097) >> 16); // 65535 -> 4096
+
+    // 16-bit levels interpolate between gamma table entries, with table position in Q8
+    uint16_t position = (uint16_t)(((uint32_t)level * 255 + 255) >> 8);
+    uint16_t index = position >> 8;
+    uint16_t fraction = position & 0xFF;
+
+    uint16_t retVal = PCA9685_DMXGamma(index);
+    if (fraction)
+        retVal += (uint16_t)(((uint32_t)(PCA9685_DMXGamma(index + 1) - retVal) * fraction) >> 8);
+    return retVal;
+}
+
+void PCA9685_DMXMapper::readPatch(int index, PCA9685_DMXPatch *patch) {
+#ifdef pgm_read_word
+    if (_patchesInProgmem) {
+        const PCA9685_DMXPatch *source = &_patches[index];
+        patch->slot = pgm_read_word(&source->slot);
+        patch->controller = pgm_read_byte(&source->controller);
+        patch->channel = pgm_read_byte(&source->channel);
+        patch->flags = pgm_read_byte(&source->flags);
+        return;
+    }
+#endif
+    *patch = _patches[index];
+}
+
+
+#ifdef PCA9685_USE_FRAME_BUFFER_SERVICE
+
+#define PCA9685_FRAME_BUFFER_READ_RETRIES   1000            // Seqlock read attempts before giving up on a slab
+
+// Reads slab's PWM amounts under its seqlock, retrying while a writer is mid-update.
+// Returns false if no consistent read was had within PCA9685_FRAME_BUFFER_READ_RETRIES
+// attempts (e.g. a client died mid-write, leaving sequence odd).
+static bool PCA9685_readFrameBufferSlab(PCA9685_FrameBufferSlab *slab, uint16_t *pwmAmounts) {
+    for (int attempt = 0; attempt < PCA9685_FRAME_BUFFER_READ_RETRIES; ++attempt) {
+        uint32_t sequence = __atomic_load_n(&slab->sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1) continue;
+
+        for (int channel = 0; channel < 16; ++channel)
+            pwmAmounts[channel] = __atomic_load_n(&slab->pwmAmounts[channel], __ATOMIC_RELAXED);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slab->sequence, __ATOMIC_RELAXED) == sequence) return true;
+    }
+
+    return false;
+}
+
+// Removes frame buffer of given name if it's proven stale, i.e. fully created by a service
+// process that's no longer running, returning true if removed. Frame buffers still being
+// created (no magic yet), or whose service can't be signalled to find out, are left alone.
+static bool PCA9685_unlinkStaleFrameBuffer(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    // Lock serializes services replacing the same stale frame buffer, so that one can't go
+    // on to unlink the replacement another has just created
+    bool isStale = false;
+    struct stat fileStat;
+    if (flock(fd, LOCK_EX) == 0 && fstat(fd, &fileStat) == 0 &&
+        (size_t)fileStat.st_size >= sizeof(PCA9685_FrameBufferHeader)) {
+        void *mapped = mmap(NULL, sizeof(PCA9685_FrameBufferHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            PCA9685_FrameBufferHeader *header = (PCA9685_FrameBufferHeader *)mapped;
+            if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == PCA9685_FRAME_BUFFER_MAGIC &&
+                header->version == PCA9685_FRAME_BUFFER_VERSION && header->ownerPid > 0) {
+                isStale = kill((pid_t)header->ownerPid, 0) != 0 && errno == ESRCH;
+            }
+            munmap(mapped, sizeof(PCA9685_FrameBufferHeader));
+        }
+    }
+
+    if (isStale) {
+        // Name must still refer to the same frame buffer
+        struct stat nameStat;
+        int nameFd = shm_open(name, O_RDONLY, 0);
+        isStale = nameFd >= 0 && fstat(nameFd, &nameStat) == 0 &&
+                  nameStat.st_dev == fileStat.st_dev && nameStat.st_ino == fileStat.st_ino;
+        if (nameFd >= 0) close(nameFd);
+        if (isStale) shm_unlink(name);
+    }
+
+    close(fd);
+    return isStale;
+}
+
+PCA9685_FrameBufferService::PCA9685_FrameBufferService(PCA9685 **pwmControllers, int numControllers)
+    : _pwmControllers(pwmControllers), _numControllers(numControllers), _name(), _header(NULL), _mappedLength(0),
+      _busThread(), _busThreadRunning(false), _stopping(false), _framePeriodNanos(0), _frameOverruns(0)
+{ }
+
+PCA9685_FrameBufferService::~PCA9685_FrameBufferService() {
+    end();
+}
+
+bool PCA9685_FrameBufferService::begin(float frameRate, const char *name, mode_t mode) {
+    end();
+    if (_numControllers < 1 || _numControllers > 0xFFFF) return false;
+
+    strncpy(_name, name, sizeof(_name) - 1);
+    _name[sizeof(_name) - 1] = '\0';
+    _mappedLength = sizeof(PCA9685_FrameBufferHeader) + _numControllers * sizeof(PCA9685_FrameBufferSlab);
+
+    int fd = shm_open(_name, O_CREAT | O_EXCL | O_RDWR, mode);
+    if (fd < 0 && errno == EEXIST && PCA9685_unlinkStaleFrameBuffer(_name)) // e.g. from a crashed service
+        fd = shm_open(_name, O_CREAT | O_EXCL | O_RDWR, mode);
+    if (fd < 0) return false;
+    // Mode is set explicitly, as shm_open's is masked by the process's umask
+    if (fchmod(fd, mode) != 0 || ftruncate(fd, _mappedLength) != 0) {
+        close(fd);
+        shm_unlink(_name);
+        return false;
+    }
+    void *mapped = mmap(NULL, _mappedLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(_name);
+        return false;
+    }
+
+    _header = (PCA9685_FrameBufferHeader *)mapped;
+    PCA9685_FrameBufferSlab *slabs = (PCA9685_FrameBufferSlab *)(_header + 1);
+    for (int controller = 0; controller < _numControllers; ++controller) {
+        PCA9685 *pwmController = _pwmControllers[controller];
+        slabs[controller].sequence = 0;
+        slabs[controller].dirtyChannels = 0;
+        slabs[controller].i2cAddress = pwmController->getI2CAddress();
+        slabs[controller].reserved = 0;
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+        for (int channel = 0; channel < 16; ++channel)
+            slabs[controller].pwmAmounts[channel] = pwmController->_pwmAmounts[channel];
+#else
+        pwmController->getChannelsPWM(0, 16, slabs[controller].pwmAmounts);
+#endif
+    }
+    _header->version = PCA9685_FRAME_BUFFER_VERSION;
+    _header->numSlabs = (uint16_t)_numControllers;
+    _header->framesFlushed = 0;
+    _header->ownerPid = (uint32_t)getpid();
+    __atomic_store_n(&_header->magic, PCA9685_FRAME_BUFFER_MAGIC, __ATOMIC_RELEASE); // Stored last, as clients check it upon attach
+
+    _stopping = false;
+    _frameOverruns = 0;
+    if (frameRate > 0) {
+        setFrameRate(frameRate);
+        if (pthread_create(&_busThread, NULL, busThreadMain, this) != 0) {
+            end();
+            return false;
+        }
+        _busThreadRunning = true;
+    }
+
+    return true;
+}
+
+void PCA9685_FrameBufferService::end() {
+    if (_busThreadRunning) {
+        __atomic_store_n(&_stopping, true, __ATOMIC_RELEASE);
+        pthread_join(_busThread, NULL);
+        _busThreadRunning = false;
+    }
+
+    if (_header) {
+        munmap(_header, _mappedLength);
+        shm_unlink(_name);
+        _header = NULL;
+    }
+}
+
+void PCA9685_FrameBufferService::setFrameRate(float frameRate) {
+    if (frameRate <= 0) return;
+
+    float framePeriodNanos = 1000000000.0f / frameRate;
+    __atomic_store_n(&_framePeriodNanos, (uint32_t)min(framePeriodNanos, 4000000000.0f), __ATOMIC_RELAXED);
+}
+
+int PCA9685_FrameBufferService::flush() {
+    if (!_header) return 0;
+
+    int retVal = 0;
+    PCA9685_FrameBufferSlab *slabs = (PCA9685_FrameBufferSlab *)(_header + 1);
+
+    for (int controller = 0; controller < _numControllers; ++controller) {
+        // Dirty channels are claimed before reading, so that any write landing after gets
+        // flushed next frame, rather than lost
+        uint16_t dirtyChannels = __atomic_exchange_n(&slabs[controller].dirtyChannels, 0, __ATOMIC_ACQUIRE);
+        if (!dirtyChannels) continue;
+
+        uint16_t pwmAmounts[16];
+        if (!PCA9685_readFrameBufferSlab(&slabs[controller], pwmAmounts)) {
+            // Slab skipped this frame, rather than stalling the other slabs behind it
+            __atomic_fetch_or(&slabs[controller].dirtyChannels, dirtyChannels, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        PCA9685 *pwmController = _pwmControllers[controller];
+        retVal += pwmController->setChangedChannelsPWM(pwmController->getChangedChannels(dirtyChannels, pwmAmounts), pwmAmounts);
+
+        if (pwmController->getLastI2CError()) // Retried next frame
+            __atomic_fetch_or(&slabs[controller].dirtyChannels, dirtyChannels, __ATOMIC_RELAXED);
+    }
+
+    __atomic_fetch_add(&_header->framesFlushed, 1, __ATOMIC_RELAXED);
+    return retVal;
+}
+
+uint32_t PCA9685_FrameBufferService::getFramesFlushed() {
+    return _header ? __atomic_load_n(&_header->framesFlushed, __ATOMIC_RELAXED) : 0;
+}
+
+uint32_t PCA9685_FrameBufferService::getFrameOverruns() {
+    return __atomic_load_n(&_frameOverruns, __ATOMIC_RELAXED);
+}
+
+void *PCA9685_FrameBufferService::busThreadMain(void *service) {
+    PCA9685_FrameBufferService *self = (PCA9685_FrameBufferService *)service;
+    struct timespec nextFrame;
+    clock_gettime(CLOCK_MONOTONIC, &nextFrame);
+
+    while (!__atomic_load_n(&self->_stopping, __ATOMIC_ACQUIRE)) {
+        self->flush();
+
+        uint32_t framePeriodNanos = __atomic_load_n(&self->_framePeriodNanos, __ATOMIC_RELAXED);
+        nextFrame.tv_sec += framePeriodNanos / 1000000000UL;
+        nextFrame.tv_nsec += framePeriodNanos % 1000000000UL;
+        if (nextFrame.tv_nsec >= 1000000000L) {
+            nextFrame.tv_sec += 1;
+            nextFrame.tv_nsec -= 1000000000L;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > nextFrame.tv_sec || (now.tv_sec == nextFrame.tv_sec && now.tv_nsec >= nextFrame.tv_nsec)) {
+            // Next frame starts now, rather than trying to catch up with back-to-back flushes
+            __atomic_fetch_add(&self->_frameOverruns, 1, __ATOMIC_RELAXED);
+            nextFrame = now;
+        }
+        else {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextFrame, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+PCA9685_FrameBufferClient::PCA9685_FrameBufferClient()
+    : _header(NULL), _mappedLength(0)
+{ }
+
+PCA9685_FrameBufferClient::~PCA9685_FrameBufferClient() {
+    detach();
+}
+
+bool PCA9685_FrameBufferClient::attach(const char *name) {
+    detach();
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return false;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(PCA9685_FrameBufferHeader)) {
+        close(fd);
+        return false;
+    }
+    void *mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    PCA9685_FrameBufferHeader *header = (PCA9685_FrameBufferHeader *)mapped;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != PCA9685_FRAME_BUFFER_MAGIC ||
+        header->version != PCA9685_FRAME_BUFFER_VERSION ||
+        sizeof(PCA9685_FrameBufferHeader) + header->numSlabs * sizeof(PCA9685_FrameBufferSlab) > (size_t)fileStat.st_size) {
+        munmap(mapped, (size_t)fileStat.st_size);
+        return false;
+    }
+
+    _header = header;
+    _mappedLength = (size_t)fileStat.st_size;
+    return true;
+}
+
+void PCA9685_FrameBufferClient::detach() {
+    if (_header) {
+        munmap(_header, _mappedLength);
+        _header = NULL;
+    }
+}
+
+int PCA9685_FrameBufferClient::getNumSlabs() {
+    return _header ? _header->numSlabs : 0;
+}
+
+int PCA9685_FrameBufferClient::getSlabIndex(byte i2cAddress) {
+    for (int slab = 0; slab < getNumSlabs(); ++slab) {
+        if ((getSlab(slab)->i2cAddress & PCA9685_I2C_BASE_MODULE_ADRMASK) == (i2cAddress & PCA9685_I2C_BASE_MODULE_ADRMASK))
+            return slab;
+    }
+    return -1;
+}
+
+void PCA9685_FrameBufferClient::setChannelPWM(int slab, int channel, uint16_t pwmAmount) {
+    setChannelsPWM(slab, channel, 1, &pwmAmount);
+}
+
+void PCA9685_FrameBufferClient::setChannelsPWM(int slab, int begChannel, int numChannels, const uint16_t *pwmAmounts) {
+    PCA9685_FrameBufferSlab *frameSlab = getSlab(slab);
+    if (!frameSlab || begChannel < 0 || begChannel > 15 || numChannels < 1) return;
+    if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
+
+    // Takes seqlock, spinning while another writer holds it
+    uint32_t sequence = __atomic_load_n(&frameSlab->sequence, __ATOMIC_RELAXED);
+    do {
+        while (sequence & 1)
+            sequence = __atomic_load_n(&frameSlab->sequence, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&frameSlab->sequence, &sequence, sequence + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    // Keeps the stores below from becoming visible before the odd sequence does
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    uint16_t channelMask = 0;
+    for (int channel = begChannel; channel < begChannel + numChannels; ++channel) {
+        uint16_t pwmAmount = *pwmAmounts++;
+        __atomic_store_n(&frameSlab->pwmAmounts[channel], min(pwmAmount, PCA9685_PWM_FULL), __ATOMIC_RELAXED);
+        channelMask |= (uint16_t)1 << channel;
+    }
+
+    // Released so that a flush claiming these dirty bits also sees the stores above
+    __atomic_fetch_or(&frameSlab->dirtyChannels, channelMask, __ATOMIC_RELEASE);
+    __atomic_store_n(&frameSlab->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+uint16_t PCA9685_FrameBufferClient::getChannelPWM(int slab, int channel) {
+    uint16_t pwmAmount = 0;
+    getChannelsPWM(slab, channel, 1, &pwmAmount);
+    return pwmAmount;
+}
+
+bool PCA9685_FrameBufferClient::getChannelsPWM(int slab, int begChannel, int numChannels, uint16_t *pwmAmounts) {
+    PCA9685_FrameBufferSlab *frameSlab = getSlab(slab);
+    if (!frameSlab || begChannel < 0 || begChannel > 15 || numChannels < 1) return false;
+    if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
+
+    uint16_t slabAmounts[16];
+    if (!PCA9685_readFrameBufferSlab(frameSlab, slabAmounts)) return false;
+    memcpy(pwmAmounts, &slabAmounts[begChannel], numChannels * sizeof(uint16_t));
+    return true;
+}
+
+PCA9685_FrameBufferSlab *PCA9685_FrameBufferClient::getSlab(int slab) {
+    if (!_header || slab < 0 || slab >= _header->numSlabs) return NULL;
+    return &((PCA9685_FrameBufferSlab *)(_header + 1))[slab];
+}
+
+#endif // /ifdef PCA9685_USE_FRAME_BUFFER_SERVICE
+
+
+#ifdef PCA9685_ENABLE_RECORDER
+
+// Record tag bits and kinds
+#define PCA9685_RECORD_TAG_TIMED            (byte)0x80
+#define PCA9685_RECORD_TAG_KIND_MASK        (byte)0x60
+#define PCA9685_RECORD_TAG_INDEX_MASK       (byte)0x1F
+#define PCA9685_RECORD_TAG_BEGIN_SAME       (byte)0x10
+#define PCA9685_RECORD_KIND_CHANNEL         (byte)0x00
+#define PCA9685_RECORD_KIND_REGISTER        (byte)0x20
+#define PCA9685_RECORD_KIND_DEVICE          (byte)0x40
+#define PCA9685_RECORD_KIND_SPECIAL         (byte)0x60
+#define PCA9685_RECORD_SPECIAL_ALLLED       (byte)0x00
+#define PCA9685_RECORD_SPECIAL_RESET        (byte)0x01
+
+PCA9685_Recorder *PCA9685::_recorder = NULL;
+
+static byte *PCA9685_encodeVarint(byte *out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (byte)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (byte)value;
+    return out;
+}
+
+static uint16_t PCA9685_zigzagDelta(uint16_t value, uint16_t lastValue) {
+    int16_t delta = (int16_t)(value - lastValue);
+    return (uint16_t)((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+}
+
+static uint16_t PCA9685_unzigzagDelta(uint32_t zigzag, uint16_t lastValue) {
+    return lastValue + (uint16_t)((zigzag >> 1) ^ -(zigzag & 1));
+}
+
+PCA9685_RecordState::PCA9685_RecordState()
+    : _numDevices(0), _device(-1), _i2cAddress(0xFF), _deviceAddresses(), _phaseBegins(), _phaseEnds()
+{ }
+
+void PCA9685_RecordState::resetState() {
+    _numDevices = 0;
+    _device = -1;
+    _i2cAddress = 0xFF;
+}
+
+void PCA9685_RecordState::selectDevice(byte i2cAddress) {
+    _i2cAddress = i2cAddress;
+
+    for (_device = 0; _device < _numDevices; ++_device)
+        if (_deviceAddresses[_device] == i2cAddress) return;
+
+    if (_numDevices < PCA9685_RECORDER_MAX_DEVICES) {
+        _deviceAddresses[_device] = i2cAddress;
+        for (int channel = 0; channel < 16; ++channel)
+            _phaseBegins[_device][channel] = _phaseEnds[_device][channel] = 0;
+        ++_numDevices;
+    }
+    else {
+        _device = -1;
+    }
+}
+
+uint16_t PCA9685_RecordState::getLastPhaseBegin(int channel) {
+    return _device >= 0 ? _phaseBegins[_device][channel] : 0;
+}
+
+uint16_t PCA9685_RecordState::getLastPhaseEnd(int channel) {
+    return _device >= 0 ? _phaseEnds[_device][channel] : 0;
+}
+
+void PCA9685_RecordState::updateState(int channel, uint16_t phaseBegin, uint16_t phaseEnd) {
+    if (_device < 0) return;
+
+    if (channel == PCA9685_ALLLED_CHANNEL) {
+        for (channel = 0; channel < 16; ++channel) {
+            _phaseBegins[_device][channel] = phaseBegin;
+            _phaseEnds[_device][channel] = phaseEnd;
+        }
+    }
+    else {
+        _phaseBegins[_device][channel] = phaseBegin;
+        _phaseEnds[_device][channel] = phaseEnd;
+    }
+}
+
+PCA9685_Recorder::PCA9685_Recorder()
+    : _output(NULL), _lastMicros(0), _recordMicros(0), _bytesRecorded(0), _numPendingChannels(0)
+{ }
+
+PCA9685_Recorder::~PCA9685_Recorder() {
+    end();
+}
+
+void PCA9685_Recorder::begin(Print &output) {
+    if (PCA9685::_recorder) PCA9685::_recorder->end();
+
+    resetState();
+    _output = &output;
+    _lastMicros = micros();
+    _bytesRecorded = 0;
+    _numPendingChannels = 0;
+
+    byte header[3] = { PCA9685_RECORD_MAGIC0, PCA9685_RECORD_MAGIC1, PCA9685_RECORD_VERSION };
+    emit(header, 3);
+
+    if (_output) PCA9685::_recorder = this;
+}
+
+void PCA9685_Recorder::end() {
+    if (PCA9685::_recorder == this) PCA9685::_recorder = NULL;
+    _output = NULL;
+}
+
+bool PCA9685_Recorder::isRecording() {
+    return _output != NULL;
+}
+
+uint32_t PCA9685_Recorder::getBytesRecorded() {
+    return _bytesRecorded;
+}
+
+void PCA9685_Recorder::recordChannel(byte i2cAddress, byte regAddress, uint16_t phaseBegin, uint16_t phaseEnd) {
+    // Held until transaction ends, as it may yet fail (at most 16 channels fit in one)
+    if (_numPendingChannels >= 16) return;
+
+    PendingChannel &pending = _pendingChannels[_numPendingChannels++];
+    pending.i2cAddress = i2cAddress;
+    pending.regAddress = regAddress;
+    pending.phaseBegin = phaseBegin;
+    pending.phaseEnd = phaseEnd;
+}
+
+void PCA9685_Recorder::commitChannels() {
+    // Whole transaction shares one timestamp, keeping its later records untimed so that
+    // they play back as one burst
+    _recordMicros = micros();
+
+    for (int index = 0; index < _numPendingChannels; ++index) {
+        const PendingChannel &pending = _pendingChannels[index];
+        encodeChannel(pending.i2cAddress, pending.regAddress, pending.phaseBegin, pending.phaseEnd);
+    }
+    _numPendingChannels = 0;
+}
+
+void PCA9685_Recorder::discardChannels() {
+    _numPendingChannels = 0;
+}
+
+void PCA9685_Recorder::encodeChannel(byte i2cAddress, byte regAddress, uint16_t phaseBegin, uint16_t phaseEnd) {
+    byte buffer[20];
+    byte *out = encodeDevice(buffer, i2cAddress);
+
+    if (regAddress == PCA9685_ALLLED_REG) {
+        out = encodeTag(out, PCA9685_RECORD_KIND_SPECIAL | PCA9685_RECORD_SPECIAL_ALLLED);
+        out = PCA9685_encodeVarint(out, phaseBegin);
+        out = PCA9685_encodeVarint(out, phaseEnd);
+        updateState(PCA9685_ALLLED_CHANNEL, phaseBegin, phaseEnd);
+    }
+    else {
+        int channel = ((regAddress - PCA9685_LED0_REG) >> 2) & 0x0F;
+        bool beginSame = phaseBegin == getLastPhaseBegin(channel);
+
+        out = encodeTag(out, PCA9685_RECORD_KIND_CHANNEL | (beginSame ? PCA9685_RECORD_TAG_BEGIN_SAME : 0) | channel);
+        if (!beginSame)
+            out = PCA9685_encodeVarint(out, PCA9685_zigzagDelta(phaseBegin, getLastPhaseBegin(channel)));
+        // Phase end is taken relative to phase begin, so that moved phases (e.g. Packed
+        // phase balancer) with an unchanged PWM amount encode in a single byte
+        out = PCA9685_encodeVarint(out, PCA9685_zigzagDelta(phaseEnd - phaseBegin, getLastPhaseEnd(channel) - getLastPhaseBegin(channel)));
+        updateState(channel, phaseBegin, phaseEnd);
+    }
+
+    emit(buffer, (int)(out - buffer));
+}
+
+void PCA9685_Recorder::recordRegister(byte i2cAddress, byte regAddress, byte value) {
+    _recordMicros = micros();
+
+    byte buffer[16];
+    byte *out = encodeDevice(buffer, i2cAddress);
+
+    out = encodeTag(out, PCA9685_RECORD_KIND_REGISTER);
+    *out++ = regAddress;
+    *out++ = value;
+
+    emit(buffer, (int)(out - buffer));
+}
+
+void PCA9685_Recorder::recordReset() {
+    _recordMicros = micros();
+
+    byte buffer[8];
+    byte *out = encodeTag(buffer, PCA9685_RECORD_KIND_SPECIAL | PCA9685_RECORD_SPECIAL_RESET);
+
+    emit(buffer, (int)(out - buffer));
+}
+
+byte *PCA9685_Recorder::encodeTag(byte *out, byte tag) {
+    uint32_t delta = _recordMicros - _lastMicros;
+    _lastMicros = _recordMicros;
+
+    if (!delta) {
+        *out++ = tag;
+        return out;
+    }
+    *out++ = tag | PCA9685_RECORD_TAG_TIMED;
+    return PCA9685_encodeVarint(out, delta);
+}
+
+byte *PCA9685_Recorder::encodeDevice(byte *out, byte i2cAddress) {
+    if (_i2cAddress == i2cAddress) return out;
+
+    out = encodeTag(out, PCA9685_RECORD_KIND_DEVICE);
+    *out++ = i2cAddress;
+    selectDevice(i2cAddress);
+    return out;
+}
+
+void PCA9685_Recorder::emit(const byte *buffer, int length) {
+    if (!_output) return;
+
+    size_t written = _output->write(buffer, length);
+    _bytesRecorded += written;
+    if (written < (size_t)length) end();
+}
+
+PCA9685_Player::PCA9685_Player(PCA9685 **pwmControllers, int numControllers)
+    : _pwmControllers(pwmControllers), _numControllers(numControllers), _input(NULL), _speed(1), _dueMicros(0),
+      _pending(false), _timed(false), _kind(0), _index(0), _regAddress(0), _value(0), _phaseBegin(0), _phaseEnd(0),
+      _pwmController(NULL), _burstController(NULL), _burstRegAddress(0), _burstChannels(0), _recordsPlayed(0)
+{ }
+
+bool PCA9685_Player::begin(Stream &input, float speed) {
+    end();
+
+    resetState();
+    _input = &input;
+    _speed = speed;
+    _pwmController = NULL;
+    _recordsPlayed = 0;
+
+    byte header[3];
+    if (!readByte(&header[0]) || !readByte(&header[1]) || !readByte(&header[2]) ||
+        header[0] != PCA9685_RECORD_MAGIC0 || header[1] != PCA9685_RECORD_MAGIC1 || header[2] != PCA9685_RECORD_VERSION) {
+        _input = NULL;
+        return false;
+    }
+
+    _dueMicros = micros();
+    _pending = readRecord();
+    return true;
+}
+
+void PCA9685_Player::end() {
+    endBurst();
+    _input = NULL;
+    _pending = false;
+}
+
+bool PCA9685_Player::update() {
+    if (!_input) return false;
+
+    while (_pending && (_speed <= 0 || (int32_t)(micros() - _dueMicros) >= 0)) {
+        playRecord();
+        ++_recordsPlayed;
+        _pending = readRecord();
+    }
+    endBurst();
+
+    if (!_pending) end();
+    return _input != NULL;
+}
+
+bool PCA9685_Player::isPlaying() {
+    return _input != NULL;
+}
+
+uint32_t PCA9685_Player::getRecordsPlayed() {
+    return _recordsPlayed;
+}
+
+bool PCA9685_Player::readRecord() {
+    byte tag;
+    if (!readByte(&tag)) return false;
+
+    _timed = tag & PCA9685_RECORD_TAG_TIMED;
+    if (_timed) {
+        uint32_t delta;
+        if (!readVarint(&delta)) return false;
+        if (_speed > 0)
+            _dueMicros += (uint32_t)((float)delta / _speed + 0.5f);
+    }
+
+    _kind = tag & PCA9685_RECORD_TAG_KIND_MASK;
+    _index = tag & PCA9685_RECORD_TAG_INDEX_MASK;
+
+    // Record state is updated as records are read, mirroring recorder
+    switch (_kind) {
+        case PCA9685_RECORD_KIND_CHANNEL: {
+            uint32_t beginZigzag = 0, endZigzag;
+            if (!(_index & PCA9685_RECORD_TAG_BEGIN_SAME) && !readVarint(&beginZigzag)) return false;
+            if (!readVarint(&endZigzag)) return false;
+            _index &= 0x0F;
+            _phaseBegin = PCA9685_unzigzagDelta(beginZigzag, getLastPhaseBegin(_index));
+            _phaseEnd = _phaseBegin + PCA9685_unzigzagDelta(endZigzag, getLastPhaseEnd(_index) - getLastPhaseBegin(_index));
+            updateState(_index, _phaseBegin, _phaseEnd);
+        } return true;
+
+        case PCA9685_RECORD_KIND_REGISTER:
+            return readByte(&_regAddress) && readByte(&_value);
+
+        case PCA9685_RECORD_KIND_DEVICE:
+            if (!readByte(&_regAddress)) return false;
+            selectDevice(_regAddress);
+            return true;
+
+        case PCA9685_RECORD_KIND_SPECIAL:
+            if (_index == PCA9685_RECORD_SPECIAL_ALLLED) {
+                uint32_t phaseBegin, phaseEnd;
+                if (!readVarint(&phaseBegin) || !readVarint(&phaseEnd)) return false;
+                _phaseBegin = (uint16_t)phaseBegin;
+                _phaseEnd = (uint16_t)phaseEnd;
+                updateState(PCA9685_ALLLED_CHANNEL, _phaseBegin, _phaseEnd);
+            }
+            return true;
+    }
+
+    return false;
+}
+
+bool PCA9685_Player::readByte(byte *data) {
+    int value = _input->read();
+    if (value < 0) return false;
+    *data = (byte)value;
+    return true;
+}
+
+bool PCA9685_Player::readVarint(uint32_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        byte data;
+        if (!readByte(&data)) return false;
+        *value |= (uint32_t)(data & 0x7F) << shift;
+        if (!(data & 0x80)) return true;
+    }
+    return false;
+}
+
+void PCA9685_Player::playRecord() {
+    switch (_kind) {
+        case PCA9685_RECORD_KIND_CHANNEL: {
+            if (!_pwmController) break;
+            byte regAddress = PCA9685_LED0_REG + (_index << 2);
+
+#ifndef PCA9685_USE_SOFTWARE_I2C
+            bool burstFull = _burstChannels >= (PCA9685_I2C_BUFFER_LENGTH - 1) / 4;
+#else
+            bool burstFull = false;
+#endif
+            if (_timed || _burstController != _pwmController || _burstRegAddress != regAddress || burstFull) {
+                endBurst();
+                _pwmController->writeChannelRegBegin(regAddress);
+                _burstController = _pwmController;
+                _burstRegAddress = regAddress;
+                _burstChannels = 0;
+            }
+
+            _pwmController->writeChannelPWM(_phaseBegin, _phaseEnd);
+            _pwmController->updateChannelCache(_index, _phaseBegin, _phaseEnd);
+            _burstRegAddress += 4;
+            ++_burstChannels;
+        } break;
+
+        case PCA9685_RECORD_KIND_REGISTER:
+            endBurst();
+            if (_pwmController)
+                _pwmController->writeRegister(_regAddress, _value);
+            break;
+
+        case PCA9685_RECORD_KIND_DEVICE:
+            endBurst();
+            _pwmController = NULL;
+            for (int controller = 0; controller < _numControllers; ++controller) {
+                if (_pwmControllers[controller]->getI2CAddress() == _regAddress) {
+                    _pwmController = _pwmControllers[controller];
+                    break;
+                }
+            }
+            break;
+
+        case PCA9685_RECORD_KIND_SPECIAL:
+            endBurst();
+            if (_index == PCA9685_RECORD_SPECIAL_ALLLED && _pwmController) {
+                _pwmController->writeChannelRegBegin(PCA9685_ALLLED_REG);
+                _pwmController->writeChannelPWM(_phaseBegin, _phaseEnd);
+                _pwmController->writeChannelEnd();
+                for (int channel = 0; channel < 16; ++channel)
+                    _pwmController->updateChannelCache(channel, _phaseBegin, _phaseEnd);
+            }
+            else if (_index == PCA9685_RECORD_SPECIAL_RESET && _numControllers > 0) {
+                _pwmControllers[0]->resetDevices();
+            }
+            break;
+    }
+}
+
+void PCA9685_Player::endBurst() {
+    if (_burstController) {
+        _burstController->writeChannelEnd();
+        _burstController = NULL;
+    }
+}
+
+PCA9685_RecordBuffer::PCA9685_RecordBuffer(byte *buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(0), _readIndex(0)
+{ }
+
+size_t PCA9685_RecordBuffer::write(uint8_t data) {
+    return write(&data, 1);
+}
+
+size_t PCA9685_RecordBuffer::write(const uint8_t *buffer, size_t size) {
+    if (_length + size > _size) return 0;
+    memcpy(&_buffer[_length], buffer, size);
+    _length += size;
+    return size;
+}
+
+int PCA9685_RecordBuffer::available() {
+    return (int)(_length - _readIndex);
+}
+
+int PCA9685_RecordBuffer::read() {
+    return _readIndex < _length ? _buffer[_readIndex++] : -1;
+}
+
+int PCA9685_RecordBuffer::peek() {
+    return _readIndex < _length ? _buffer[_readIndex] : -1;
+}
+
+void PCA9685_RecordBuffer::flush() {
+}
+
+void PCA9685_RecordBuffer::rewind() {
+    _readIndex = 0;
+}
+
+void PCA9685_RecordBuffer::clear() {
+    _length = _readIndex = 0;
+}
+
+size_t PCA9685_RecordBuffer::getLength() {
+    return _length;
+}
+
+size_t PCA9685_RecordBuffer::getSize() {
+    return _size;
+}
+
+#endif // /ifdef PCA9685_ENABLE_RECORDER
+
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+
+PCA9685_BusProfiler PCA9685_BusProfiler::_profilers[PCA9685_BUS_PROFILER_MAX_BUSES];
+byte PCA9685_BusProfiler::_numProfilers = 0;
+uint32_t PCA9685_BusProfiler::_windowMicros = 250000;
+
+#ifndef PCA9685_USE_SOFTWARE_I2C
+
+PCA9685_BusProfiler *PCA9685_BusProfiler::getProfiler(TwoWire &i2cWire) {
+    return getProfiler(&i2cWire, false);
+}
+
+#else
+
+PCA9685_BusProfiler *PCA9685_BusProfiler::getProfiler() {
+    return getProfiler(NULL, false);
+}
+
+#endif // /ifndef PCA9685_USE_SOFTWARE_I2C
+
+void PCA9685_BusProfiler::setWindowLength(uint32_t windowMicros) {
+    _windowMicros = max(windowMicros, (uint32_t)1);
+
+    for (int index = 0; index < _numProfilers; ++index)
+        _profilers[index].reset();
+}
+
+PCA9685_BusProfiler *PCA9685_BusProfiler::getProfiler(const void *bus, bool create) {
+    for (int index = 0; index < _numProfilers; ++index) {
+        if (_profilers[index]._bus == bus)
+            return &_profilers[index];
+    }
+
+    if (!create || _numProfilers >= PCA9685_BUS_PROFILER_MAX_BUSES) return NULL;
+
+    PCA9685_BusProfiler *profiler = &_profilers[_numProfilers++];
+    profiler->_bus = bus;
+    profiler->reset();
+    return profiler;
+}
+
+void PCA9685_BusProfiler::record(const void *bus, byte i2cAddress, uint16_t numBytes, uint32_t i2cSpeed, uint32_t blockedMicros) {
+    PCA9685_BusProfiler *profiler = getProfiler(bus, true);
+    if (!profiler) return;
+
+    profiler->slideWindow();
+
+    // START + address byte + data bytes (each 8 bits + ACK) + STOP, with bit time in Q4
+    // microseconds being 16000000 / speed, kept in 32 bits for transactions < 268k bits
+    uint32_t busTimeQ4 = ((uint32_t)(numBytes + 1) * 9 + 2) * 16000 / max(i2cSpeed / 1000, (uint32_t)1);
+
+    profiler->_busTimesQ4[profiler->_windowIndex] += busTimeQ4;
+    profiler->_blockedMicros[profiler->_windowIndex] += blockedMicros;
+
+    int device = 0;
+    while (device < profiler->_numDevices && profiler->_deviceAddresses[device] != i2cAddress)
+        ++device;
+    if (device == profiler->_numDevices) {
+        if (device == PCA9685_BUS_PROFILER_MAX_DEVICES) {
+            device = PCA9685_BUS_PROFILER_MAX_DEVICES - 1; // Table full, last entry catches the rest
+            profiler->_deviceAddresses[device] = 0xFF;
+        }
+        else {
+            profiler->_deviceAddresses[profiler->_numDevices++] = i2cAddress;
+        }
+    }
+    profiler->_deviceTimesQ4[device][profiler->_windowIndex] += busTimeQ4;
+}
+
+void PCA9685_BusProfiler::slideWindow() {
+    uint32_t now = micros();
+
+    if (now - _windowBegin >= _windowMicros * PCA9685_BUS_PROFILER_WINDOWS) {
+        // Idle long enough for every sub-window to have expired
+        memset(_busTimesQ4, 0, sizeof(_busTimesQ4));
+        memset(_blockedMicros, 0, sizeof(_blockedMicros));
+        memset(_deviceTimesQ4, 0, sizeof(_deviceTimesQ4));
+        _windowBegin = now;
+        return;
+    }
+
+    while (now - _windowBegin >= _windowMicros) {
+        _windowBegin += _windowMicros;
+        if (++_windowIndex >= PCA9685_BUS_PROFILER_WINDOWS) _windowIndex = 0;
+
+        _busTimesQ4[_windowIndex] = 0;
+        _blockedMicros[_windowIndex] = 0;
+        for (int device = 0; device < _numDevices; ++device)
+            _deviceTimesQ4[device][_windowIndex] = 0;
+    }
+}
+
+uint32_t PCA9685_BusProfiler::getWindowMicros() {
+    slideWindow();
+
+    uint32_t now = micros();
+    return min(_windowMicros * (PCA9685_BUS_PROFILER_WINDOWS - 1) + (now - _windowBegin), now - _startMicros);
+}
+
+uint32_t PCA9685_BusProfiler::getBusMicros() {
+    slideWindow();
+
+    uint32_t busTimeQ4 = 0;
+    for (int window = 0; window < PCA9685_BUS_PROFILER_WINDOWS; ++window)
+        busTimeQ4 += _busTimesQ4[window];
+    return busTimeQ4 >> 4;
+}
+
+uint32_t PCA9685_BusProfiler::getBlockedMicros() {
+    slideWindow();
+
+    uint32_t blockedMicros = 0;
+    for (int window = 0; window < PCA9685_BUS_PROFILER_WINDOWS; ++window)
+        blockedMicros += _blockedMicros[window];
+    return blockedMicros;
+}
+
+float PCA9685_BusProfiler::getUtilization() {
+    uint32_t windowMicros = getWindowMicros();
+    float utilization = windowMicros ? getBusMicros() / (float)windowMicros : 0.0f;
+    return min(utilization, 1.0f);
+}
+
+float PCA9685_BusProfiler::getBlockedUtilization() {
+    uint32_t windowMicros = getWindowMicros();
+    float utilization = windowMicros ? getBlockedMicros() / (float)windowMicros : 0.0f;
+    return min(utilization, 1.0f);
+}
+
+float PCA9685_BusProfiler::getHeadroom() {
+    return 1.0f - getUtilization();
+}
+
+uint32_t PCA9685_BusProfiler::getDeviceTimeQ4(int device) {
+    uint32_t deviceTimeQ4 = 0;
+    for (int window = 0; window < PCA9685_BUS_PROFILER_WINDOWS; ++window)
+        deviceTimeQ4 += _deviceTimesQ4[device][window];
+    return deviceTimeQ4;
+}
+
+int PCA9685_BusProfiler::getTopConsumers(byte *i2cAddresses, uint32_t *busMicros, int maxConsumers) {
+    slideWindow();
+
+    // Insertion sort into output, heaviest first, dropping whatever falls off the end
+    int numConsumers = 0;
+    for (int device = 0; device < _numDevices; ++device) {
+        uint32_t deviceMicros = getDeviceTimeQ4(device) >> 4;
+        if (!deviceMicros) continue;
+
+        int index = min(numConsumers, maxConsumers);
+        while (index > 0 && busMicros[index - 1] < deviceMicros) {
+            if (index < maxConsumers) {
+                i2cAddresses[index] = i2cAddresses[index - 1];
+                busMicros[index] = busMicros[index - 1];
+            }
+            --index;
+        }
+        if (index < maxConsumers) {
+            i2cAddresses[index] = _deviceAddresses[device];
+            busMicros[index] = deviceMicros;
+            if (numConsumers < maxConsumers) ++numConsumers;
+        }
+    }
+
+    return numConsumers;
+}
+
+void PCA9685_BusProfiler::printReport(Print &output) {
+    uint32_t windowMicros = getWindowMicros();
+
+    output.println(""); output.println(" ~~~ PCA9685 Bus Profile ~~~");
+    output.print("Window: "); output.print(windowMicros); output.print("us");
+    output.print(", bus time: "); output.print(getBusMicros()); output.print("us");
+    output.print(", blocked time: "); output.print(getBlockedMicros()); output.println("us");
+    output.print("Utilization: "); output.print(getUtilization() * 100.0f); output.print("%");
+    output.print(", blocked: "); output.print(getBlockedUtilization() * 100.0f); output.print("%");
+    output.print(", headroom: "); output.print(getHeadroom() * 100.0f); output.println("%");
+
+    byte i2cAddresses[PCA9685_BUS_PROFILER_MAX_DEVICES];
+    uint32_t busMicros[PCA9685_BUS_PROFILER_MAX_DEVICES];
+    int numConsumers = getTopConsumers(i2cAddresses, busMicros, PCA9685_BUS_PROFILER_MAX_DEVICES);
+
+    for (int index = 0; index < numConsumers; ++index) {
+        output.print("  0x"); output.print(i2cAddresses[index], HEX);
+        output.print(": "); output.print(busMicros[index]); output.print("us (");
+        output.print(windowMicros ? busMicros[index] * 100.0f / windowMicros : 0.0f);
+        output.println("%)");
+    }
+}
+
+void PCA9685_BusProfiler::reset() {
+    _startMicros = _windowBegin = micros();
+    _windowIndex = 0;
+    _numDevices = 0;
+    memset(_busTimesQ4, 0, sizeof(_busTimesQ4));
+    memset(_blockedMicros, 0, sizeof(_blockedMicros));
+    memset(_deviceTimesQ4, 0, sizeof(_deviceTimesQ4));
+}
+
+#endif // /ifdef PCA9685_ENABLE_BUS_PROFILER
@@ -40,6 +40,45 @@
 // Uncomment or -D this define to enable debug output.
 //#define PCA9685_ENABLE_DEBUG_OUTPUT
 
+// Uncomment or -D this define to enable the per-instance channel cache, needed by the Packed/Custom phase balancers, glitch-free updates, and phase planning, and letting frame buffers (and DMX mapping, in place of a last amounts buffer) write only changed channels.
+//#define PCA9685_ENABLE_CHANNEL_CACHE
+
+// Uncomment or -D this define to set the maximum number of calibration points that servo evaluators can hold (default: 3 on AVR, 9 otherwise).
+//#define PCA9685_SERVOEVAL_MAX_POINTS        9
+
+// Uncomment or -D this define to set the number of distinct Wire instance and i2c speed pairs that PCA9685 instances constructed without a PCA9685_Bus can share bus state for (default: 4).
+//#define PCA9685_MAX_SHARED_BUSES            4
+
+// Uncomment or -D this define to enable per-instance i2c performance counters (see getStats).
+//#define PCA9685_ENABLE_PERF_COUNTERS
+
+// Uncomment or -D this define to enable tracing of i2c activity into a RAM ring buffer (see printTrace), a low-overhead alternative to debug output.
+//#define PCA9685_ENABLE_TRACE
+
+// Uncomment or -D this define to set the number of events the trace ring buffer holds (default: 16 on AVR, 128 otherwise).
+//#define PCA9685_TRACE_SIZE                  128
+
+// Uncomment or -D this define to enable log2-bucketed latency histograms of public API calls (see printLatencyHistograms).
+//#define PCA9685_ENABLE_LATENCY_HISTOGRAMS
+
+// Uncomment or -D this define to set the number of log2 buckets each latency histogram holds (default: 12 on AVR, 16 otherwise).
+//#define PCA9685_LATENCY_BUCKETS             16
+
+// Uncomment or -D this define to enable i2c bus utilization profiling, shared per Wire instance (see PCA9685_BusProfiler).
+//#define PCA9685_ENABLE_BUS_PROFILER
+
+// Uncomment or -D this define to set the number of device addresses each bus profiler tracks (default: 8 on AVR, 16 otherwise).
+//#define PCA9685_BUS_PROFILER_MAX_DEVICES    16
+
+// Uncomment or -D this define to enable the shared memory frame buffer service on Linux hosts (see PCA9685_FrameBufferService).
+//#define PCA9685_ENABLE_FRAME_BUFFER_SERVICE
+
+// Uncomment or -D this define to enable delta-compressed recording and playback of i2c writes (see PCA9685_Recorder).
+//#define PCA9685_ENABLE_RECORDER
+
+// Uncomment or -D this define to set the number of devices recordings track channel deltas for (default: 2 on AVR, 16 otherwise).
+//#define PCA9685_RECORDER_MAX_DEVICES        16
+
 // Hookup Callouts
 // -PLEASE READ-
 // Many digital servos run on a 20ms pulse width (50Hz update frequency) based duty cycle,
@@ -77,6 +116,146 @@
 #define PCA9685_USE_SOFTWARE_I2C
 #endif // /ifndef PCA9685_ENABLE_SOFTWARE_I2C
 
+#if defined(PCA9685_ENABLE_FRAME_BUFFER_SERVICE) && defined(__linux__)
+#include <pthread.h>
+#include <sys/types.h>
+#define PCA9685_USE_FRAME_BUFFER_SERVICE
+#endif
+
+
+// Allows GCC to if-convert floating-point selects in batch evaluation loops, which it
+// otherwise won't do under the default -ftrapping-math, so that they can be vectorized.
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__AVR__)
+#define PCA9685_VECTORIZABLE                __attribute__((optimize("no-trapping-math")))
+#else
+#define PCA9685_VECTORIZABLE
+#endif
+
+
+#ifndef PCA9685_SERVOEVAL_MAX_POINTS
+#ifdef __AVR__
+#define PCA9685_SERVOEVAL_MAX_POINTS        3
+#else
+#define PCA9685_SERVOEVAL_MAX_POINTS        9
+#endif
+#endif // /ifndef PCA9685_SERVOEVAL_MAX_POINTS
+#if PCA9685_SERVOEVAL_MAX_POINTS < 3
+#error "PCA9685_SERVOEVAL_MAX_POINTS must be at least 3"
+#endif
+
+#ifndef PCA9685_USE_SOFTWARE_I2C
+#ifndef PCA9685_MAX_SHARED_BUSES
+#define PCA9685_MAX_SHARED_BUSES            4
+#endif // /ifndef PCA9685_MAX_SHARED_BUSES
+#endif // /ifndef PCA9685_USE_SOFTWARE_I2C
+
+#ifdef PCA9685_ENABLE_TRACE
+#ifndef PCA9685_TRACE_SIZE
+#ifdef __AVR__
+#define PCA9685_TRACE_SIZE                  16
+#else
+#define PCA9685_TRACE_SIZE                  128
+#endif
+#endif // /ifndef PCA9685_TRACE_SIZE
+
+// Trace event operation.
+enum PCA9685_TraceOp {
+    PCA9685_TraceOp_Reset,                      // Software reset sent to all devices on i2c line
+    PCA9685_TraceOp_RegisterWrite,              // Register written, value1 = value
+    PCA9685_TraceOp_RegisterRead,               // Register read, value1 = value
+    PCA9685_TraceOp_ChannelWrite,               // Channel registers queued for write, value1/value2 = phase begin/end
+    PCA9685_TraceOp_ChannelRead,                // Channel registers read, value1/value2 = phase begin/end
+    PCA9685_TraceOp_TransmissionEnd,            // Write transaction ended, value1 = bytes sent since begin
+    PCA9685_TraceOp_ReadRequest,                // Read requested, value1/value2 = bytes requested/received
+
+    PCA9685_TraceOp_Count,                      // Internal use only
+};
+
+// Trace event, as recorded into trace ring buffer. Kept compact so that recording only
+// takes a handful of stores, with decoding left for when the trace is printed out.
+struct PCA9685_TraceEvent {
+    uint32_t timestamp;                                     // micros() at time of event
+    byte op;                                                // PCA9685_TraceOp
+    byte i2cAddress;                                        // Module's i2c address
+    byte regAddress;                                        // Register address (for channel ops, LEDx_ON_L of channel)
+    byte error;                                             // i2c error code, if any
+    uint16_t value1;                                        // Op-specific value
+    uint16_t value2;                                        // Op-specific value
+};
+#endif // /ifdef PCA9685_ENABLE_TRACE
+
+#ifdef PCA9685_ENABLE_LATENCY_HISTOGRAMS
+#ifndef PCA9685_LATENCY_BUCKETS
+#ifdef __AVR__
+#define PCA9685_LATENCY_BUCKETS             12
+#else
+#define PCA9685_LATENCY_BUCKETS             16
+#endif
+#endif // /ifndef PCA9685_LATENCY_BUCKETS
+
+// Latency histogram operation, grouping public API calls.
+enum PCA9685_LatencyOp {
+    PCA9685_LatencyOp_Init,                     // resetDevices, init, initAsProxyAddresser
+    PCA9685_LatencyOp_SetPWMFrequency,          // setPWMFrequency, setPWMFrequencyQ4, setPWMFreqServo
+    PCA9685_LatencyOp_SetChannelPWM,            // setChannelOn, setChannelOff, setChannelPWM
+    PCA9685_LatencyOp_SetChannelsPWM,           // setChannelsPWM
+    PCA9685_LatencyOp_SetAllChannelsPWM,        // setAllChannelsPWM
+    PCA9685_LatencyOp_SetChannelPhase,          // setChannelPhase, setChannelsPhase
+    PCA9685_LatencyOp_GetChannelPWM,            // getChannelPWM
+    PCA9685_LatencyOp_GetChannelsPWM,           // getChannelsPWM
+    PCA9685_LatencyOp_Config,                   // enable/disable[AllCall|Sub1-Sub3]Address, enableExtClockLine, enable/disableGlitchFreeUpdates
+
+    PCA9685_LatencyOp_Count,                    // Internal use only
+    PCA9685_LatencyOp_Undefined = -1            // Internal use only
+};
+#endif // /ifdef PCA9685_ENABLE_LATENCY_HISTOGRAMS
+
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+#ifndef PCA9685_BUS_PROFILER_MAX_DEVICES
+#ifdef __AVR__
+#define PCA9685_BUS_PROFILER_MAX_DEVICES    8
+#else
+#define PCA9685_BUS_PROFILER_MAX_DEVICES    16
+#endif
+#endif // /ifndef PCA9685_BUS_PROFILER_MAX_DEVICES
+#ifdef __AVR__
+#define PCA9685_BUS_PROFILER_MAX_BUSES      1
+#else
+#define PCA9685_BUS_PROFILER_MAX_BUSES      4
+#endif
+#define PCA9685_BUS_PROFILER_WINDOWS        4
+class PCA9685_BusProfiler;
+#endif // /ifdef PCA9685_ENABLE_BUS_PROFILER
+
+#ifdef PCA9685_ENABLE_RECORDER
+#ifndef PCA9685_RECORDER_MAX_DEVICES
+#ifdef __AVR__
+#define PCA9685_RECORDER_MAX_DEVICES        2
+#else
+#define PCA9685_RECORDER_MAX_DEVICES        16
+#endif
+#endif // /ifndef PCA9685_RECORDER_MAX_DEVICES
+class PCA9685_Recorder;
+#endif // /ifdef PCA9685_ENABLE_RECORDER
+
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+// i2c performance counters, kept per module instance. Bus utilization can be charted by
+// sampling bytesWritten + bytesRead (plus one address byte per transaction and read)
+// over time, and NACKs are split out by the error code endTransmission returned.
+struct PCA9685_Stats {
+    uint32_t transactions;                                  // Write transactions ended (endTransmission calls)
+    uint32_t reads;                                         // Read requests made (requestFrom calls)
+    uint32_t bytesWritten;                                  // Bytes written, not including address bytes
+    uint32_t bytesRead;                                     // Bytes read, not including address bytes
+    uint16_t dataTooLongErrors;                             // Error 1: data too long to fit in transmit buffer
+    uint16_t addressNacks;                                  // Error 2: NACK received on transmit of address
+    uint16_t dataNacks;                                     // Error 3: NACK received on transmit of data
+    uint16_t otherErrors;                                   // Error 4+: other errors (e.g. timeouts, short reads)
+    uint32_t suppressedWrites;                              // Writes skipped as having no effect (e.g. unchanged pre-scaler)
+    uint32_t coalescedWrites;                               // Channel writes sharing a transaction with a previous channel write
+    uint32_t endTransmissionMicros;                         // Total time spent blocked in endTransmission, in microseconds
+};
+#endif
 
 // Default proxy addresser i2c addresses
 #define PCA9685_I2C_DEF_ALLCALL_PROXYADR    (byte)0xE0      // Default AllCall i2c proxy address
@@ -84,6 +263,38 @@
 #define PCA9685_I2C_DEF_SUB2_PROXYADR       (byte)0xE4      // Default Sub2 i2c proxy address
 #define PCA9685_I2C_DEF_SUB3_PROXYADR       (byte)0xE8      // Default Sub3 i2c proxy address
 
+// Data sheet constants needed by the inline and template code below, kept out of the
+// global namespace as they aren't part of the public interface (see PCA9685.cpp).
+namespace PCA9685_Detail {
+    // Module base i2c addresses
+    constexpr byte I2C_BASE_MODULE_ADDRESS      = 0x40;
+    constexpr byte I2C_BASE_MODULE_ADRMASK      = 0x3F;
+
+    // Register addresses
+    constexpr byte MODE1_REG                    = 0x00;
+    constexpr byte MODE2_REG                    = 0x01;
+    constexpr byte LED0_REG                     = 0x06;     // Start of LEDx regs, 4B per reg, 2B on phase, 2B off phase, little-endian
+    constexpr byte PRESCALE_REG                 = 0xFE;
+    constexpr byte ALLLED_REG                   = 0xFA;
+
+    // Mode1 register values
+    constexpr byte MODE1_RESTART                = 0x80;
+    constexpr byte MODE1_AUTOINC                = 0x20;
+    constexpr byte MODE1_SLEEP                  = 0x10;
+
+    // Mode2 register values
+    constexpr byte MODE2_OUTDRV_TPOLE           = 0x04;
+    constexpr byte MODE2_INVRT                  = 0x10;
+    constexpr byte MODE2_OUTNE_TPHIGH           = 0x01;
+    constexpr byte MODE2_OUTNE_HIGHZ            = 0x02;
+    constexpr byte MODE2_OCH_ONACK              = 0x08;
+
+    constexpr byte SW_RESET                     = 0x06;     // Sent to address 0x00 to reset all devices on Wire line
+    constexpr uint16_t PWM_FULL                 = 0x1000;   // Special value for full on/full off LEDx modes
+    constexpr uint16_t PWM_MASK                 = 0x0FFF;   // Mask for 12-bit/4096 possible phase positions
+    constexpr int ALLLED_CHANNEL                = -1;       // Special value for ALLLED registers
+}
+
 
 // Output driver control mode (see datasheet Table 12 and Fig 13, 14, and 15 concerning correct
 // usage of OUTDRV).
@@ -150,6 +361,10 @@ enum PCA9685_ChannelUpdateMode {
 enum PCA9685_PhaseBalancer {
     PCA9685_PhaseBalancer_None,                 // Disables software-based phase balancing, relying on installed hardware to handle current sinkage (default)
     PCA9685_PhaseBalancer_Linear,               // Uses linear software-based phase balancing, with each channel being a preset 16 steps (out of the 4096/12-bit value range) away from previous channel (may cause LED flickering/skipped-cycles on PWM changes)
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    PCA9685_PhaseBalancer_Packed,               // Uses load-aware software-based phase balancing, with each channel's high phase packed end-to-end after previous channel's (wrapping around the 4096/12-bit value range), minimizing the peak number of channels high at once (may cause LED flickering/skipped-cycles on PWM changes)
+    PCA9685_PhaseBalancer_Custom,               // Uses user-defined phase offsets set via setChannelPhaseOffset(s), with each channel's high phase beginning at its offset
+#endif
 
     PCA9685_PhaseBalancer_Count,                // Internal use only
     PCA9685_PhaseBalancer_Undefined = -1        // Internal use only
@@ -163,7 +378,312 @@ enum PCA9685_PhaseBalancer {
 // will skip a cycle between PWM changes when the leading/trailing edge is shifted past a
 // certain point. While we may revisit this idea in the future, for now we're content on
 // leaving None as the default, and limiting the shift that Linear applies.
+// Packed lays each channel's high phase directly after the previous channel's, so that
+// at most ceil(sum of PWM amounts / 4096) channels are ever high at the same time. As
+// each channel's phase depends upon the PWM amounts of the channels before it, changing
+// a channel's PWM amount will also rewrite those later channels whose phase has moved.
+// See enableGlitchFreeUpdates() for a way to avoid skipped-cycles on PWM changes.
+
+
+// Register values and phase math shared by PCA9685, PCA9685T, and PCA9685_Device.
+namespace PCA9685_Detail {
+    // Returns MODE2 register value for given modes.
+    constexpr byte getMode2Value(PCA9685_OutputDriverMode driverMode,
+                                 PCA9685_OutputEnabledMode enabledMode,
+                                 PCA9685_OutputDisabledMode disabledMode,
+                                 PCA9685_ChannelUpdateMode updateMode) {
+        return (driverMode == PCA9685_OutputDriverMode_TotemPole ? MODE2_OUTDRV_TPOLE : 0) |
+               (enabledMode == PCA9685_OutputEnabledMode_Inverted ? MODE2_INVRT : 0) |
+               (disabledMode == PCA9685_OutputDisabledMode_High ? MODE2_OUTNE_TPHIGH :
+                disabledMode == PCA9685_OutputDisabledMode_Floating ? MODE2_OUTNE_HIGHZ : 0) |
+               (updateMode == PCA9685_ChannelUpdateMode_AfterAck ? MODE2_OCH_ONACK : 0);
+    }
+
+    // Returns pre-scaler value for PWM frequency in fixed-point Q4 (1/16th Hz). This
+    // equation comes from section 7.3.5 of the datasheet, with rounding done to the
+    // nearest pre-scaler value. Lowest freq is 23.84, highest is 1525.88 (at 25MHz).
+    // With frequency in Q4, 4096 * freq becomes 256 * freqQ4, keeping it all in 32 bits.
+    inline byte getPreScalerValue(uint32_t oscFrequency, uint16_t pwmFrequencyQ4) {
+        uint32_t divisor = (uint32_t)pwmFrequencyQ4 << 8;
+        long preScalerVal = (long)((oscFrequency + (divisor >> 1)) / divisor) - 1;
+        if (preScalerVal > 255) preScalerVal = 255;
+        if (preScalerVal < 3) preScalerVal = 3;
+        return (byte)preScalerVal;
+    }
+
+    // Returns PWM frequency in fixed-point Q4, with anything over 4095Hz being well past
+    // the highest possible frequency anyways.
+    inline uint16_t getPWMFrequencyQ4(float pwmFrequency) {
+        return pwmFrequency < 4095 ? (uint16_t)(pwmFrequency * 16 + 0.5f) : 0xFFFF;
+    }
+
+    // Returns Linear phase balancer's phase begin for channel, distributing high phase
+    // area over more of the duty cycle range to balance load. ALLLED should not receive
+    // a phase shifted begin value.
+    constexpr uint16_t getLinearPhaseBegin(int channel) {
+        return channel != ALLLED_CHANNEL ? (channel * ((4096 / 16) / 16)) & PWM_MASK : 0;
+    }
+
+    // Returns phase cycle for PWM amount with high phase beginning at phaseOffset.
+    inline void getPhaseCycle(uint16_t phaseOffset, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd) {
+        *phaseBegin = phaseOffset;
+
+        // See datasheet section 7.3.3
+        if (pwmAmount == 0) {
+            // Full OFF -> time_end[bit12] = 1
+            *phaseEnd = PWM_FULL;
+        }
+        else if (pwmAmount >= PWM_FULL) {
+            // Full ON -> time_beg[bit12] = 1, time_end[bit12] = <ignored>
+            *phaseBegin |= PWM_FULL;
+            *phaseEnd = 0;
+        }
+        else {
+            *phaseEnd = (phaseOffset + pwmAmount) & PWM_MASK;
+        }
+    }
+
+    // Returns PWM amount for phase cycle, as read back from module.
+    inline uint16_t getPWMForPhaseCycle(uint16_t phaseBegin, uint16_t phaseEnd) {
+        // See datasheet section 7.3.3
+        if (phaseEnd >= PWM_FULL)
+            // Full OFF
+            // Figure 11 Example 4: full OFF takes precedence over full ON
+            // See also remark after Table 7
+            return 0;
+        else if (phaseBegin >= PWM_FULL)
+            // Full ON
+            // Figure 9 Example 3
+            return PWM_FULL;
+        else if (phaseBegin <= phaseEnd)
+            // start and finish in same cycle
+            // Section 7.3.3 example 1
+            return phaseEnd - phaseBegin;
+        else
+            // span cycles
+            // Section 7.3.3 example 2
+            return (phaseEnd + PWM_FULL) - phaseBegin;
+    }
+}
+
+// Register sequences shared by PCA9685, PCA9685T, and PCA9685_Device, written once over
+// a Module type so that each class keeps its own i2c handling (e.g. PCA9685's tracing
+// and counters). Module provides writeRegister(regAddress, value), readRegister(
+// regAddress), getLastI2CError(), writeChannelRegBegin(regAddress), writeChannelPWM(
+// phaseBegin, phaseEnd), writeChannelEnd(), and prepareChannelPWM(channel, pwmAmount,
+// &phaseBegin, &phaseEnd), the latter returning the phase cycle to write channel with.
+struct PCA9685_Core {
+    // Writes mode registers, restarting module with register auto-increment enabled.
+    template<class Module>
+    static void writeModes(Module &module, byte mode2Val) {
+        module.writeRegister(PCA9685_Detail::MODE1_REG, PCA9685_Detail::MODE1_RESTART | PCA9685_Detail::MODE1_AUTOINC);
+        module.writeRegister(PCA9685_Detail::MODE2_REG, mode2Val);
+    }
+
+    // Writes pre-scaler value, returning true only if every step went through.
+    template<class Module>
+    static bool writePreScaler(Module &module, byte preScalerVal) {
+        // The PRE_SCALE register can only be set when the SLEEP bit of MODE1 register is set to logic 1.
+        byte mode1Reg = module.readRegister(PCA9685_Detail::MODE1_REG);
+        bool succeeded = !module.getLastI2CError();
+        module.writeRegister(PCA9685_Detail::MODE1_REG, (mode1Reg = (mode1Reg & ~PCA9685_Detail::MODE1_RESTART) | PCA9685_Detail::MODE1_SLEEP));
+        succeeded = succeeded && !module.getLastI2CError();
+        module.writeRegister(PCA9685_Detail::PRESCALE_REG, preScalerVal);
+        succeeded = succeeded && !module.getLastI2CError();
+
+        // It takes 500us max for the oscillator to be up and running once SLEEP bit has been set to logic 0.
+        module.writeRegister(PCA9685_Detail::MODE1_REG, (mode1Reg = (mode1Reg & ~PCA9685_Detail::MODE1_SLEEP) | PCA9685_Detail::MODE1_RESTART));
+        succeeded = succeeded && !module.getLastI2CError();
+        delayMicroseconds(500);
+
+        return succeeded;
+    }
+
+    // Writes single phase cycle into channel registers at given register address.
+    template<class Module>
+    static void writeChannelPhase(Module &module, byte regAddress, uint16_t phaseBegin, uint16_t phaseEnd) {
+        module.writeChannelRegBegin(regAddress);
+        module.writeChannelPWM(phaseBegin, phaseEnd);
+        module.writeChannelEnd();
+    }
+
+    // Writes PWM amounts into already range checked channels, at most maxChannelsPerWrite
+    // channels per transaction, returning false if stopped short by an i2c error.
+    template<class Module>
+    static bool writeChannelsPWM(Module &module, int begChannel, int numChannels, const uint16_t *pwmAmounts, int maxChannelsPerWrite) {
+        while (numChannels > 0) {
+            module.writeChannelRegBegin(PCA9685_Detail::LED0_REG + (begChannel << 2));
+
+            int maxChannels = min(numChannels, maxChannelsPerWrite);
+            numChannels -= maxChannels;
+            while (maxChannels-- > 0) {
+                uint16_t phaseBegin, phaseEnd;
+                module.prepareChannelPWM(begChannel++, *pwmAmounts++, &phaseBegin, &phaseEnd);
+                module.writeChannelPWM(phaseBegin, phaseEnd);
+            }
+
+            module.writeChannelEnd();
+            if (module.getLastI2CError()) return false;
+        }
+        return true;
+    }
+};
+
+#ifndef PCA9685_USE_SOFTWARE_I2C
+
+#ifndef PCA9685_SWAP_PWM_BEG_END_REGS
+#define PCA9685_SWAP_PWM_BEG_END_REGS_DEFAULT   false
+#else
+#define PCA9685_SWAP_PWM_BEG_END_REGS_DEFAULT   true
+#endif
+
+template<bool SwapBegEndRegs> struct PCA9685_BusModule;
+namespace PCA9685_Detail { class BusRef; }
+
+// Shared i2c bus state, so that the Wire instance, speed, and last error are kept once
+// per bus rather than once per module. Used directly by compact PCA9685_Device handles,
+// and by PCA9685 instances either given one or sharing one from the shared bus pool.
+class PCA9685_Bus {
+public:
+    // Bus constructor. See PCA9685 main constructor.
+    constexpr PCA9685_Bus(TwoWire& i2cWire = Wire, uint32_t i2cSpeed = 400000)
+        : _i2cWire(&i2cWire), _i2cSpeed(i2cSpeed), _lastI2CError(0), _refCount(0)
+    { }
+
+    // Resets all PCA9685 devices on bus. See PCA9685::resetDevices.
+    void resetDevices();
+
+    uint32_t getI2CSpeed();
+    byte getLastI2CError();
+
+protected:
+    TwoWire* _i2cWire;                                      // Wire class instance (unowned) (default: Wire)
+    uint32_t _i2cSpeed;                                     // Bus i2c clock speed (default: 400000)
+    byte _lastI2CError;                                     // Last bus i2c error
+    byte _refCount;                                         // Number of PCA9685 instances using bus
+    static PCA9685_Bus _sharedBuses[PCA9685_MAX_SHARED_BUSES]; // Shared bus pool, for PCA9685 instances constructed without a bus
+
+    // Returns shared bus for Wire instance and speed, taken from shared bus pool, or NULL
+    // if pool is full.
+    static PCA9685_Bus *getSharedBus(TwoWire& i2cWire, uint32_t i2cSpeed);
+
+    void begin() {
+        _i2cWire->setClock(_i2cSpeed);
+    }
+
+    void writeChannelBegin(byte i2cAddress, byte regAddress) {
+        _i2cWire->beginTransmission(i2cAddress);
+        _i2cWire->write(regAddress);
+    }
+
+    void writeChannelPWM(uint16_t phaseBegin, uint16_t phaseEnd, bool swapBegEndRegs) {
+        if (swapBegEndRegs) {
+            uint16_t swap = phaseBegin; phaseBegin = phaseEnd; phaseEnd = swap;
+        }
+
+        _i2cWire->write(lowByte(phaseBegin));
+        _i2cWire->write(highByte(phaseBegin));
+        _i2cWire->write(lowByte(phaseEnd));
+        _i2cWire->write(highByte(phaseEnd));
+    }
+
+    void writeChannelEnd() {
+        _lastI2CError = _i2cWire->endTransmission();
+    }
+
+    void writeRegister(byte i2cAddress, byte regAddress, byte value) {
+        _i2cWire->beginTransmission(i2cAddress);
+        _i2cWire->write(regAddress);
+        _i2cWire->write(value);
+        _lastI2CError = _i2cWire->endTransmission();
+    }
+
+    bool readRegisters(byte i2cAddress, byte regAddress, byte *values, int numValues) {
+        _i2cWire->beginTransmission(i2cAddress);
+        _i2cWire->write(regAddress);
+        if ((_lastI2CError = _i2cWire->endTransmission())) return false;
+
+        int bytesRead = _i2cWire->requestFrom(i2cAddress, (size_t)numValues);
+        if (bytesRead != numValues) {
+            while (bytesRead-- > 0)
+                _i2cWire->read();
+            _lastI2CError = 4;
+            return false;
+        }
+
+        while (numValues-- > 0)
+            *values++ = (byte)(_i2cWire->read() & 0xFF);
+        return true;
+    }
+
+    byte readRegister(byte i2cAddress, byte regAddress) {
+        byte value;
+        return readRegisters(i2cAddress, regAddress, &value, 1) ? value : 0;
+    }
+
+    friend class PCA9685;
+    friend class PCA9685_Detail::BusRef;
+    template<bool SwapBegEndRegs> friend struct PCA9685_BusModule;
+};
+
+namespace PCA9685_Detail {
+    // Counted reference to a bus, so that shared buses go back into the shared bus pool
+    // once no PCA9685 instance (including copies) uses them anymore.
+    class BusRef {
+    public:
+        explicit BusRef(PCA9685_Bus *bus) : _bus(bus) { if (_bus) ++_bus->_refCount; }
+        BusRef(const BusRef &busRef) : _bus(busRef._bus) { if (_bus) ++_bus->_refCount; }
+        ~BusRef() { if (_bus) --_bus->_refCount; }
+        BusRef &operator=(const BusRef &busRef) {
+            if (busRef._bus) ++busRef._bus->_refCount;
+            if (_bus) --_bus->_refCount;
+            _bus = busRef._bus;
+            return *this;
+        }
+
+        explicit operator bool() const { return _bus != NULL; }
+        PCA9685_Bus *operator->() const { return _bus; }
+
+    private:
+        PCA9685_Bus *_bus;                                  // Referenced bus
+    };
+}
+
+// Module on a PCA9685_Bus, as run through PCA9685_Core by PCA9685T and PCA9685_Device,
+// which only support the None and Linear phase balancers.
+template<bool SwapBegEndRegs>
+struct PCA9685_BusModule {
+    PCA9685_Bus &bus;                                       // Module's bus
+    byte i2cAddress;                                        // Module's i2c address
+    bool linearPhases;                                      // Linear phase balancer flag
+
+    void begin() { bus.begin(); }
+
+    void writeChannelRegBegin(byte regAddress) { bus.writeChannelBegin(i2cAddress, regAddress); }
+    void writeChannelPWM(uint16_t phaseBegin, uint16_t phaseEnd) { bus.writeChannelPWM(phaseBegin, phaseEnd, SwapBegEndRegs); }
+    void writeChannelEnd() { bus.writeChannelEnd(); }
+
+    void writeRegister(byte regAddress, byte value) { bus.writeRegister(i2cAddress, regAddress, value); }
+    byte readRegister(byte regAddress) { return bus.readRegister(i2cAddress, regAddress); }
+    byte getLastI2CError() { return bus._lastI2CError; }
 
+    void prepareChannelPWM(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd) {
+        PCA9685_Detail::getPhaseCycle(linearPhases ? PCA9685_Detail::getLinearPhaseBegin(channel) : 0, pwmAmount, phaseBegin, phaseEnd);
+    }
+
+    // Returns PWM amounts 0 - 4096, or 0 if channel could not be read
+    uint16_t readChannelPWM(int channel) {
+        byte values[4];
+        if (!bus.readRegisters(i2cAddress, PCA9685_Detail::LED0_REG + (channel << 2), values, 4)) return 0;
+
+        uint16_t phaseBegin = values[0] | ((uint16_t)values[1] << 8);
+        uint16_t phaseEnd = values[2] | ((uint16_t)values[3] << 8);
+        return SwapBegEndRegs ? PCA9685_Detail::getPWMForPhaseCycle(phaseEnd, phaseBegin)
+                              : PCA9685_Detail::getPWMForPhaseCycle(phaseBegin, phaseEnd);
+    }
+};
+
+#endif // /ifndef PCA9685_USE_SOFTWARE_I2C
 
 class PCA9685 {
 public:
@@ -181,6 +701,13 @@ public:
     // Convenience constructor for custom Wire instance. See main constructor.
     PCA9685(TwoWire& i2cWire, uint32_t i2cSpeed = 400000, byte i2cAddress = B000000);
 
+    // Convenience constructor for a given bus, which must outlive the instance. Instances
+    // constructed with a Wire instance and speed instead share a bus from the shared bus
+    // pool (see PCA9685_MAX_SHARED_BUSES) with all other such instances using the same
+    // Wire instance and speed. If that pool is full, such instances are left without a
+    // bus, and fail every call with an i2c error of 4. See main constructor.
+    PCA9685(PCA9685_Bus& bus, byte i2cAddress = B000000);
+
 #else
 
     // Library constructor. Typically called during class instantiation, before setup().
@@ -233,11 +760,32 @@ public:
     // Min: 24Hz, Max: 1526Hz, Default: 200Hz. As Hz increases channel resolution
     // diminishes, as raw pre-scaler value, computed per datasheet, starts to require
     // much larger frequency increases for single-digit increases of the raw pre-scaler
-    // value that ultimately controls the PWM frequency produced.
+    // value that ultimately controls the PWM frequency produced. Pre-scaler value is
+    // rounded to whichever is nearest the requested frequency, based on the oscillator
+    // frequency (nominally 25MHz, see calibrateOscFrequency and enableExtClockLine).
     void setPWMFrequency(float pwmFrequency = 200);
+    // Sets PWM frequency using the given oscillator frequency, which is then kept.
+    void setPWMFrequency(float pwmFrequency, uint32_t oscFrequency);
+    // Sets PWM frequency in fixed-point Q4 (1/16th Hz, e.g. 50Hz = 800) using only
+    // integer math. Setting a frequency that results in the pre-scaler value already
+    // in use is skipped, avoiding the module's sleep/restart cycle.
+    void setPWMFrequencyQ4(uint16_t pwmFrequencyQ4);
     // Sets standard servo frequency of 50Hz.
     void setPWMFreqServo();
 
+    // Returns actual PWM frequency being produced, as read back from pre-scaler value,
+    // which can be used to compute exact servo pulse widths (1 step = 1/(4096 * freq)).
+    float getPWMFrequency();
+
+    // Calibrates oscillator frequency from a PWM frequency measured at the output (e.g.
+    // with a scope or frequency counter) at the current pre-scaler value. The internal
+    // oscillator of real chips is often off by 5-10% from its nominal 25MHz. Call
+    // setPWMFrequency() again afterwards to retune using the calibrated value.
+    void calibrateOscFrequency(float measuredPWMFrequency);
+    // Oscillator frequency accessors, such as for restoring a stored calibration.
+    void setOscFrequency(uint32_t oscFrequency);
+    uint32_t getOscFrequency();
+
     // Turns channel either full on or full off
     void setChannelOn(int channel);
     void setChannelOff(int channel);
@@ -246,11 +794,37 @@ public:
     void setChannelPWM(int channel, uint16_t pwmAmount);
     void setChannelsPWM(int begChannel, int numChannels, const uint16_t *pwmAmounts);
 
+    // Compile-time channel versions of above (e.g. setChannelPWM<3>(2048)), for fixed
+    // wiring, which reject out of range channels at compile time and write to a constant
+    // register address.
+    template<int Channel> void setChannelOn();
+    template<int Channel> void setChannelOff();
+    template<int Channel> void setChannelPWM(uint16_t pwmAmount);
+
     // Sets all channels, but won't distribute phases
     void setAllChannelsPWM(uint16_t pwmAmount);
 
+    // Sets exact leading (on) and trailing (off) edges 0 - 4095 of channel's high phase,
+    // bypassing phase balancer. Edges may also be given 4096 (bit 12 set) to use
+    // full on (on = 4096) or full off (off = 4096), with full off taking precedence.
+    void setChannelPhase(int channel, uint16_t phaseBegin, uint16_t phaseEnd);
+    void setChannelsPhase(int begChannel, int numChannels, const uint16_t *phaseBegins, const uint16_t *phaseEnds);
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // Sets persistent phase offsets 0 - 4095 that channel's high phase begins at, which
+    // setChannelPWM and friends apply from then on. Also switches phase balancer over to
+    // PCA9685_PhaseBalancer_Custom, with channels not otherwise set defaulting to 0.
+    // Offsets only take effect on channels' next PWM update.
+    void setChannelPhaseOffset(int channel, uint16_t phaseOffset);
+    void setChannelsPhaseOffset(int begChannel, int numChannels, const uint16_t *phaseOffsets);
+    uint16_t getChannelPhaseOffset(int channel);
+#endif
+
     // Returns PWM amounts 0 - 4096, 0 full off, 4096 full on
     uint16_t getChannelPWM(int channel);
+    // Reads back numChannels channels at once, using as few i2c transactions as possible.
+    // Channels that could not be read (bad range or i2c error) are returned as 0.
+    void getChannelsPWM(int begChannel, int numChannels, uint16_t *pwmAmounts);
 
     // Enables multiple talk-through paths via i2c bus (lsb/bit0 must stay 0). To use,
     // create a new proxy instance using initAsProxyAddresser() with proper proxy i2c
@@ -264,11 +838,56 @@ public:
     void disableSub2Address();
     void disableSub3Address();
 
-    // Allows external clock line to be utilized (power reset required to disable)
-    void enableExtClockLine();
+    // Allows external clock line to be utilized (power reset required to disable), with
+    // given clock frequency (max 50MHz) used from then on by setPWMFrequency().
+    void enableExtClockLine(uint32_t extClockFrequency = 25000000);
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // Enables glitch-free channel updates, which ensure that a PWM change never drops,
+    // doubles, or elongates a pulse regardless of where the PWM counter currently is.
+    // Since only changes that lengthen a pulse by moving its trailing edge later, or
+    // shorten a pulse by moving its leading edge later, are safe to make at any time,
+    // channel phases are left to drift away from the phase balancer's layout, and are
+    // only placed back onto it when coming from full on/off. Channel states are read
+    // back from the module when enabled, and thereafter tracked from channel writes.
+    void enableGlitchFreeUpdates();
+    void disableGlitchFreeUpdates();
+    bool getGlitchFreeUpdates();
+#endif
 
     byte getLastI2CError();
 
+#ifdef PCA9685_ENABLE_TRACE
+    // Prints out recorded trace events, oldest first, decoding them into readable text.
+    // The trace ring buffer is shared by all instances, keeping the newest events.
+    static void printTrace(Print &output = Serial);
+    // Copies out raw recorded trace events, oldest first, returning the number copied.
+    static int getTraceEvents(PCA9685_TraceEvent *events, int maxEvents);
+    static void clearTrace();
+#endif
+
+#ifdef PCA9685_ENABLE_LATENCY_HISTOGRAMS
+    // Latency histograms of public API calls, timed with micros() and shared by all
+    // instances. Bucket n counts calls taking 2^n to 2^(n+1)-1 microseconds (bucket 0
+    // also counting 0), with the last bucket counting everything past that. Counts
+    // saturate at 65535. Nested calls (e.g. setChannelPWM using setChannelsPWM) are
+    // only counted under the outermost call.
+    static const uint16_t *getLatencyHistogram(PCA9685_LatencyOp op);
+    static uint32_t getLatencyCount(PCA9685_LatencyOp op);
+    static uint32_t getLatencyMax(PCA9685_LatencyOp op);
+    // Returns upper bound, in microseconds, of bucket containing given percentile 1 - 100
+    // of calls (capped by max), or 0 if no calls were recorded.
+    static uint32_t getLatencyPercentile(PCA9685_LatencyOp op, uint8_t percentile);
+    static void printLatencyHistograms(Print &output = Serial);
+    static void resetLatencyHistograms();
+#endif
+
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    // Returns i2c performance counters, accumulated since construction or last reset
+    const PCA9685_Stats &getStats();
+    void resetStats();
+#endif
+
 #ifdef PCA9685_ENABLE_DEBUG_OUTPUT
     int getWireInterfaceNumber();
     void printModuleInfo();
@@ -278,21 +897,75 @@ public:
 protected:
     byte _i2cAddress;                                       // Module's i2c address (default: B000000)
 #ifndef PCA9685_USE_SOFTWARE_I2C
-    TwoWire* _i2cWire;                                      // Wire class instance (unowned) (default: Wire)
-    uint32_t _i2cSpeed;                                     // Module's i2c clock speed (default: 400000)
-#endif
-    PCA9685_OutputDriverMode _driverMode;                   // Output driver mode
-    PCA9685_OutputEnabledMode _enabledMode;                 // OE enabled output mode
-    PCA9685_OutputDisabledMode _disabledMode;               // OE disabled output mode
-    PCA9685_ChannelUpdateMode _updateMode;                  // Channel update mode
-    PCA9685_PhaseBalancer _phaseBalancer;                   // Phase balancer scheme
-    bool _isProxyAddresser;                                 // Proxy addresser flag (disables certain functionality)
+    PCA9685_Detail::BusRef _bus;                            // Wire class instance and i2c clock speed (default: Wire @400000), or none if shared bus pool was full
+#endif
+    byte _driverMode : 1;                                   // Output driver mode
+    byte _enabledMode : 1;                                  // OE enabled output mode
+    byte _disabledMode : 2;                                 // OE disabled output mode
+    byte _updateMode : 1;                                   // Channel update mode
+#ifndef PCA9685_ENABLE_CHANNEL_CACHE
+    byte _phaseBalancer : 1;                                // Phase balancer scheme
+#else
+    byte _phaseBalancer : 2;                                // Phase balancer scheme
+#endif
+    byte _isInitialized : 1;                                // Modes set by init flag (modes are otherwise undefined)
+    byte _isProxyAddresser : 1;                             // Proxy addresser flag (disables certain functionality)
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    byte _phaseBeginsDirty : 1;                             // Phase begins need recomputing flag, used by Packed phase balancer
+    byte _glitchFreeUpdates : 1;                            // Glitch-free channel updates flag
+#endif
+    uint32_t _oscFrequency;                                 // Oscillator frequency, in Hz (default: 25000000)
+    byte _preScalerVal;                                     // Last known pre-scaler value, or 0 if unknown
     byte _lastI2CError;                                     // Last module i2c error
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    uint16_t _pwmAmounts[16];                               // Last known channel PWM amounts (channel cache)
+    uint16_t _phaseBegins[16];                              // Last known channel phase begins, or PWM_FULL if unknown (channel cache)
+    uint16_t _phaseOffsets[16];                             // Channel phase offsets, used by Custom phase balancer
+#endif
+#ifdef PCA9685_ENABLE_PERF_COUNTERS
+    PCA9685_Stats _stats;                                   // i2c performance counters
+    byte _txChannels;                                       // Channels written in current transaction, for counting coalesced writes
+#endif
+#if defined(PCA9685_ENABLE_TRACE) || defined(PCA9685_ENABLE_BUS_PROFILER)
+    byte _txI2CAddress;                                     // i2c address of current transaction, for tracing/profiling
+    uint16_t _txBytes;                                      // Bytes written in current transaction, for tracing/profiling
+#endif
+#if defined(PCA9685_ENABLE_TRACE) || defined(PCA9685_ENABLE_RECORDER)
+    byte _txRegAddress;                                     // Register address of next channel write, for tracing/recording
+#endif
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+    uint32_t _txBeginMicros;                                // micros() at begin of current transaction, for profiling
+#endif
+#ifdef PCA9685_ENABLE_TRACE
+    static PCA9685_TraceEvent _traceEvents[PCA9685_TRACE_SIZE]; // Trace ring buffer (shared)
+    static uint16_t _traceNext;                             // Trace ring buffer next write index
+    static uint16_t _traceCount;                            // Trace ring buffer number of events held
+
+    void traceEvent(byte op, byte regAddress, uint16_t value1 = 0, uint16_t value2 = 0, byte error = 0);
+#endif
+#ifdef PCA9685_ENABLE_LATENCY_HISTOGRAMS
+    static uint16_t _latencyBuckets[PCA9685_LatencyOp_Count][PCA9685_LATENCY_BUCKETS]; // Latency histograms (shared)
+    static uint32_t _latencyMaxes[PCA9685_LatencyOp_Count]; // Latency maximums, in microseconds (shared)
+    static byte _latencyDepth;                              // Public call nesting depth, only outermost call is recorded
+
+    static void recordLatency(PCA9685_LatencyOp op, uint32_t elapsed);
+    friend class PCA9685_LatencyScope;
+#endif
 
-    byte getMode2Value();
     void getPhaseCycle(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd);
+    void prepareChannelPWM(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd);
+    void resetChannelCache();
+    void updateChannelCache(int channel, uint16_t phaseBegin, uint16_t phaseEnd);
+    void invalidateChannelCache();
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    void getGlitchFreePhaseCycle(int channel, uint16_t pwmAmount, uint16_t *phaseBegin, uint16_t *phaseEnd);
+    bool updatePackedPhaseBegins(int *begChannel, int *endChannel);
+#endif
+    uint16_t getChangedChannels(uint16_t channelMask, const uint16_t *pwmAmounts);
+    int setChangedChannelsPWM(uint16_t channelMask, const uint16_t *pwmAmounts);
 
     void writeChannelBegin(int channel);
+    void writeChannelRegBegin(byte regAddress);
     void writeChannelPWM(uint16_t phaseBegin, uint16_t phaseEnd);
     void writeChannelEnd();
 
@@ -308,31 +981,1325 @@ protected:
     uint8_t i2cWire_requestFrom(uint8_t, uint8_t);
     size_t i2cWire_write(uint8_t);
     uint8_t i2cWire_read(void);
+
+    friend struct PCA9685_Core;
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    friend class PCA9685_PhasePlanner;
+#endif
+    friend class PCA9685_FrameParser;
+    friend class PCA9685_DMXMapper;
+#ifdef PCA9685_USE_FRAME_BUFFER_SERVICE
+    friend class PCA9685_FrameBufferService;
+#endif
+#ifdef PCA9685_ENABLE_RECORDER
+    static PCA9685_Recorder *_recorder;                     // Active recorder, or NULL if not recording (shared)
+
+    friend class PCA9685_Recorder;
+    friend class PCA9685_Player;
+#endif
+};
+
+#ifdef PCA9685_ENABLE_LATENCY_HISTOGRAMS
+// Times public call for the remainder of the enclosing scope, recording into latency
+// histograms on exit so that every return path gets counted.
+class PCA9685_LatencyScope {
+public:
+    PCA9685_LatencyScope(PCA9685_LatencyOp op) : _op(op), _begin(micros()) { ++PCA9685::_latencyDepth; }
+    ~PCA9685_LatencyScope() { if (--PCA9685::_latencyDepth == 0) PCA9685::recordLatency(_op, micros() - _begin); }
+private:
+    PCA9685_LatencyOp _op;
+    uint32_t _begin;
+};
+#define PCA9685_LATENCY_SCOPE(op)           PCA9685_LatencyScope latencyScope(op)
+#else
+#define PCA9685_LATENCY_SCOPE(op)
+#endif
+
+template<int Channel>
+inline void PCA9685::setChannelOn() {
+    static_assert(Channel >= 0 && Channel <= 15, "Channel out of range");
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPWM);
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // Goes through channel cache
+    setChannelOn(Channel);
+#else
+    PCA9685_Core::writeChannelPhase(*this, PCA9685_Detail::LED0_REG + (Channel << 2), PCA9685_Detail::PWM_FULL, 0);  // time_on = FULL; time_off = 0;
+#endif
+}
+
+template<int Channel>
+inline void PCA9685::setChannelOff() {
+    static_assert(Channel >= 0 && Channel <= 15, "Channel out of range");
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPWM);
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // Goes through channel cache
+    setChannelOff(Channel);
+#else
+    PCA9685_Core::writeChannelPhase(*this, PCA9685_Detail::LED0_REG + (Channel << 2), 0, PCA9685_Detail::PWM_FULL);  // time_on = 0; time_off = FULL;
+#endif
+}
+
+template<int Channel>
+inline void PCA9685::setChannelPWM(uint16_t pwmAmount) {
+    static_assert(Channel >= 0 && Channel <= 15, "Channel out of range");
+    PCA9685_LATENCY_SCOPE(PCA9685_LatencyOp_SetChannelPWM);
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // Goes through channel cache, and other channels' phases may need to move
+    setChannelPWM(Channel, pwmAmount);
+#else
+    uint16_t phaseBegin, phaseEnd;
+    getPhaseCycle(Channel, pwmAmount, &phaseBegin, &phaseEnd);
+
+    PCA9685_Core::writeChannelPhase(*this, PCA9685_Detail::LED0_REG + (Channel << 2), phaseBegin, phaseEnd);
+#endif
+}
+
+#ifndef PCA9685_USE_SOFTWARE_I2C
+
+// Compile-time configuration for PCA9685T. See individual enums for more info. Only the
+// None and Linear phase balancers are supported, as the others require runtime state.
+template<PCA9685_OutputDriverMode DriverMode = PCA9685_OutputDriverMode_TotemPole,
+         PCA9685_PhaseBalancer PhaseBalancer = PCA9685_PhaseBalancer_None,
+         bool SwapBegEndRegs = PCA9685_SWAP_PWM_BEG_END_REGS_DEFAULT,
+         int BufferLength = PCA9685_I2C_BUFFER_LENGTH,
+         PCA9685_OutputEnabledMode EnabledMode = PCA9685_OutputEnabledMode_Normal,
+         PCA9685_OutputDisabledMode DisabledMode = PCA9685_OutputDisabledMode_Low,
+         PCA9685_ChannelUpdateMode UpdateMode = PCA9685_ChannelUpdateMode_AfterStop,
+         uint32_t OscFrequency = 25000000>
+struct PCA9685_Config {
+    static const PCA9685_OutputDriverMode driverMode = DriverMode;
+    static const PCA9685_PhaseBalancer phaseBalancer = PhaseBalancer;
+    static const bool swapBegEndRegs = SwapBegEndRegs;
+    static const int bufferLength = BufferLength;
+    static const PCA9685_OutputEnabledMode enabledMode = EnabledMode;
+    static const PCA9685_OutputDisabledMode disabledMode = DisabledMode;
+    static const PCA9685_ChannelUpdateMode updateMode = UpdateMode;
+    static const uint32_t oscFrequency = OscFrequency;
+
+    static_assert(PhaseBalancer == PCA9685_PhaseBalancer_None || PhaseBalancer == PCA9685_PhaseBalancer_Linear, "Unsupported phase balancer");
+    static_assert(!(DriverMode == PCA9685_OutputDriverMode_OpenDrain && DisabledMode == PCA9685_OutputDisabledMode_High), "Unsupported combination");
+    static_assert(BufferLength >= 5, "Buffer length too small for a channel write");
+};
+
+// Compile-time configured variant of PCA9685, for builds that never change modes at
+// runtime (e.g. ATtiny/ATmega). Modes, phase balancer, register swapping, and buffer
+// length come from Config (see PCA9685_Config), so that instances only carry their i2c
+// address and bus (Wire instance, speed, and last error), and everything is inlined,
+// folding away unused branches and, when channels are constants, bounds checks. Covers
+// the hot path of PCA9685 (init, frequency, channel writes and reads), but not proxy
+// addressers, sub-addresses, glitch-free updates, channel caching, or the
+// debug/profiling defines, for which PCA9685 should be used instead.
+template<class Config = PCA9685_Config<> >
+class PCA9685T {
+public:
+    // Library constructor. See PCA9685 main constructor.
+    PCA9685T(byte i2cAddress = B000000, TwoWire& i2cWire = Wire, uint32_t i2cSpeed = 400000)
+        : _bus(i2cWire, i2cSpeed),
+          _i2cAddress(PCA9685_Detail::I2C_BASE_MODULE_ADDRESS | (i2cAddress & PCA9685_Detail::I2C_BASE_MODULE_ADRMASK))
+    { }
+
+    // Resets modules. See PCA9685::resetDevices.
+    void resetDevices() { _bus.resetDevices(); }
+
+    // Initializes module using modes from Config. Typically called in setup().
+    void init() {
+        Module module = getModule();
+        module.begin();
+        PCA9685_Core::writeModes(module, PCA9685_Detail::getMode2Value(Config::driverMode, Config::enabledMode, Config::disabledMode, Config::updateMode));
+    }
+
+    byte getI2CAddress() { return _i2cAddress; }
+    uint32_t getI2CSpeed() { return _bus.getI2CSpeed(); }
+
+    // Sets PWM frequency in fixed-point Q4 (1/16th Hz, e.g. 50Hz = 800) using only
+    // integer math, based on Config's oscillator frequency. See PCA9685::setPWMFrequency.
+    void setPWMFrequencyQ4(uint16_t pwmFrequencyQ4) {
+        if (pwmFrequencyQ4 == 0) return;
+
+        Module module = getModule();
+        PCA9685_Core::writePreScaler(module, PCA9685_Detail::getPreScalerValue(Config::oscFrequency, pwmFrequencyQ4));
+    }
+    void setPWMFrequency(float pwmFrequency = 200) {
+        if (pwmFrequency <= 0) return;
+        setPWMFrequencyQ4(PCA9685_Detail::getPWMFrequencyQ4(pwmFrequency));
+    }
+    void setPWMFreqServo() { setPWMFrequencyQ4(50 << 4); }
+
+    // Turns channel either full on or full off
+    void setChannelOn(int channel) {
+        if (channel < 0 || channel > 15) return;
+
+        Module module = getModule();
+        PCA9685_Core::writeChannelPhase(module, PCA9685_Detail::LED0_REG + (channel << 2), PCA9685_Detail::PWM_FULL, 0);  // time_on = FULL; time_off = 0;
+    }
+    void setChannelOff(int channel) {
+        if (channel < 0 || channel > 15) return;
+
+        Module module = getModule();
+        PCA9685_Core::writeChannelPhase(module, PCA9685_Detail::LED0_REG + (channel << 2), 0, PCA9685_Detail::PWM_FULL);  // time_on = 0; time_off = FULL;
+    }
+
+    // PWM amounts 0 - 4096, 0 full off, 4096 full on
+    void setChannelPWM(int channel, uint16_t pwmAmount) {
+        setChannelsPWM(channel, 1, &pwmAmount);
+    }
+    void setChannelsPWM(int begChannel, int numChannels, const uint16_t *pwmAmounts) {
+        if (begChannel < 0 || begChannel > 15 || numChannels < 0) return;
+        if (begChannel + numChannels > 16) numChannels -= (begChannel + numChannels) - 16;
+
+        Module module = getModule();
+        PCA9685_Core::writeChannelsPWM(module, begChannel, numChannels, pwmAmounts, (Config::bufferLength - 1) / 4);
+    }
+
+    // Compile-time channel versions of above. See PCA9685::setChannelPWM<Channel>.
+    template<int Channel> void setChannelOn() {
+        static_assert(Channel >= 0 && Channel <= 15, "Channel out of range");
+        setChannelOn(Channel);
+    }
+    template<int Channel> void setChannelOff() {
+        static_assert(Channel >= 0 && Channel <= 15, "Channel out of range");
+        setChannelOff(Channel);
+    }
+    template<int Channel> void setChannelPWM(uint16_t pwmAmount) {
+        static_assert(Channel >= 0 && Channel <= 15, "Channel out of range");
+        setChannelPWM(Channel, pwmAmount);
+    }
+
+    // Sets all channels, but won't distribute phases
+    void setAllChannelsPWM(uint16_t pwmAmount) {
+        Module module = getModule();
+        uint16_t phaseBegin, phaseEnd;
+        module.prepareChannelPWM(PCA9685_Detail::ALLLED_CHANNEL, pwmAmount, &phaseBegin, &phaseEnd);
+        PCA9685_Core::writeChannelPhase(module, PCA9685_Detail::ALLLED_REG, phaseBegin, phaseEnd);
+    }
+
+    // Returns PWM amounts 0 - 4096, 0 full off, 4096 full on
+    uint16_t getChannelPWM(int channel) {
+        if (channel < 0 || channel > 15) return 0;
+        return getModule().readChannelPWM(channel);
+    }
+
+    byte getLastI2CError() { return _bus.getLastI2CError(); }
+
+protected:
+    typedef PCA9685_BusModule<Config::swapBegEndRegs> Module;
+
+    PCA9685_Bus _bus;                                       // Module's bus
+    byte _i2cAddress;                                       // Module's i2c address
+
+    Module getModule() {
+        Module module = { _bus, _i2cAddress, Config::phaseBalancer == PCA9685_PhaseBalancer_Linear };
+        return module;
+    }
+};
+
+// Compact 2 byte module handle for large installations (e.g. 62 modules on one bus),
+// with modes packed into a single bitfield byte and all bus state kept by the
+// PCA9685_Bus passed into each call. Covers the same hot path as PCA9685T, and likewise
+// only supports the None and Linear phase balancers.
+class PCA9685_Device {
+public:
+    // Handle constructor. The i2c address should be the value of the A5-A0 pins.
+    constexpr PCA9685_Device(byte i2cAddress = B000000)
+        : _i2cAddress(PCA9685_Detail::I2C_BASE_MODULE_ADDRESS | (i2cAddress & PCA9685_Detail::I2C_BASE_MODULE_ADRMASK)),
+          _driverMode(PCA9685_OutputDriverMode_TotemPole), _enabledMode(PCA9685_OutputEnabledMode_Normal),
+          _disabledMode(PCA9685_OutputDisabledMode_Low), _updateMode(PCA9685_ChannelUpdateMode_AfterStop),
+          _phaseBalancer(PCA9685_PhaseBalancer_None)
+    { }
+
+    // Initializes module. See PCA9685::init.
+    void init(PCA9685_Bus &bus,
+              PCA9685_OutputDriverMode driverMode = PCA9685_OutputDriverMode_TotemPole,
+              PCA9685_OutputEnabledMode enabledMode = PCA9685_OutputEnabledMode_Normal,
+              PCA9685_OutputDisabledMode disabledMode = PCA9685_OutputDisabledMode_Low,
+              PCA9685_ChannelUpdateMode updateMode = PCA9685_ChannelUpdateMode_AfterStop,
+              PCA9685_PhaseBalancer phaseBalancer = PCA9685_PhaseBalancer_None);
+
+    // Mode accessors
+    byte getI2CAddress();
+    PCA9685_OutputDriverMode getOutputDriverMode();
+    PCA9685_OutputEnabledMode getOutputEnabledMode();
+    PCA9685_OutputDisabledMode getOutputDisabledMode();
+    PCA9685_ChannelUpdateMode getChannelUpdateMode();
+    PCA9685_PhaseBalancer getPhaseBalancer();
+
+    // See PCA9685::setPWMFrequency, using nominal 25MHz oscillator frequency
+    void setPWMFrequency(PCA9685_Bus &bus, float pwmFrequency = 200);
+    void setPWMFrequencyQ4(PCA9685_Bus &bus, uint16_t pwmFrequencyQ4);
+    void setPWMFreqServo(PCA9685_Bus &bus);
+
+    // Turns channel either full on or full off
+    void setChannelOn(PCA9685_Bus &bus, int channel);
+    void setChannelOff(PCA9685_Bus &bus, int channel);
+
+    // PWM amounts 0 - 4096, 0 full off, 4096 full on
+    void setChannelPWM(PCA9685_Bus &bus, int channel, uint16_t pwmAmount);
+    void setChannelsPWM(PCA9685_Bus &bus, int begChannel, int numChannels, const uint16_t *pwmAmounts);
+
+    // Sets all channels, but won't distribute phases
+    void setAllChannelsPWM(PCA9685_Bus &bus, uint16_t pwmAmount);
+
+    // Returns PWM amounts 0 - 4096, 0 full off, 4096 full on
+    uint16_t getChannelPWM(PCA9685_Bus &bus, int channel);
+
+private:
+    typedef PCA9685_BusModule<PCA9685_SWAP_PWM_BEG_END_REGS_DEFAULT> Module;
+
+    byte _i2cAddress;                                       // Module's i2c address
+    byte _driverMode : 1;                                   // Output driver mode
+    byte _enabledMode : 1;                                  // OE enabled output mode
+    byte _disabledMode : 2;                                 // OE disabled output mode
+    byte _updateMode : 1;                                   // Channel update mode
+    byte _phaseBalancer : 1;                                // Phase balancer scheme (None or Linear)
+
+    Module getModule(PCA9685_Bus &bus) {
+        Module module = { bus, _i2cAddress, (bool)_phaseBalancer };
+        return module;
+    }
+};
+
+// Fleet of compact module handles sharing one bus, with modules addressed by index. With
+// default addressing, module index n uses i2c address n (A5-A0). A full 62 module fleet
+// takes 124 bytes of handles, plus the bus.
+template<int NumDevices>
+class PCA9685_Fleet {
+public:
+    // Fleet constructor. See PCA9685 main constructor.
+    PCA9685_Fleet(TwoWire& i2cWire = Wire, uint32_t i2cSpeed = 400000)
+        : _bus(i2cWire, i2cSpeed)
+    {
+        static_assert(NumDevices > 0 && NumDevices <= 62, "Fleet must have 1 to 62 modules");
+        for (int device = 0; device < NumDevices; ++device)
+            _devices[device] = PCA9685_Device(device);
+    }
+
+    // Resets all modules, then initializes each with the given modes. See PCA9685::init.
+    void init(PCA9685_OutputDriverMode driverMode = PCA9685_OutputDriverMode_TotemPole,
+              PCA9685_OutputEnabledMode enabledMode = PCA9685_OutputEnabledMode_Normal,
+              PCA9685_OutputDisabledMode disabledMode = PCA9685_OutputDisabledMode_Low,
+              PCA9685_ChannelUpdateMode updateMode = PCA9685_ChannelUpdateMode_AfterStop,
+              PCA9685_PhaseBalancer phaseBalancer = PCA9685_PhaseBalancer_None) {
+        _bus.resetDevices();
+        for (int device = 0; device < NumDevices; ++device)
+            _devices[device].init(_bus, driverMode, enabledMode, disabledMode, updateMode, phaseBalancer);
+    }
+
+    void setPWMFrequency(float pwmFrequency = 200) {
+        for (int device = 0; device < NumDevices; ++device)
+            _devices[device].setPWMFrequency(_bus, pwmFrequency);
+    }
+
+    void setChannelPWM(int device, int channel, uint16_t pwmAmount) {
+        if (device < 0 || device >= NumDevices) return;
+        _devices[device].setChannelPWM(_bus, channel, pwmAmount);
+    }
+    void setChannelsPWM(int device, int begChannel, int numChannels, const uint16_t *pwmAmounts) {
+        if (device < 0 || device >= NumDevices) return;
+        _devices[device].setChannelsPWM(_bus, begChannel, numChannels, pwmAmounts);
+    }
+    uint16_t getChannelPWM(int device, int channel) {
+        if (device < 0 || device >= NumDevices) return 0;
+        return _devices[device].getChannelPWM(_bus, channel);
+    }
+
+    PCA9685_Bus &getBus() { return _bus; }
+    PCA9685_Device &getDevice(int device) { return _devices[device]; }
+    int getNumDevices() { return NumDevices; }
+
+private:
+    PCA9685_Bus _bus;                                       // Shared bus
+    PCA9685_Device _devices[NumDevices];                    // Module handles
 };
 
-// Class to assist with calculating Servo PWM values from angle/speed values
+#endif // /ifndef PCA9685_USE_SOFTWARE_I2C
+
+// Class to assist with calculating Servo PWM values from angle/speed values. Uses no heap
+// memory, and the linear and 3 point cubic spline constructors are constexpr, allowing
+// constant servo evaluators to be built at compile time (and on most non-AVR boards, to
+// be stored in flash as a result of being declared constexpr).
 class PCA9685_ServoEval {
 public:
     // Uses a linear interpolation method to quickly compute PWM output value. Uses
     // default values of 2.5% and 12.5% of phase length for -90/+90 (or -1x/+1x).
-    PCA9685_ServoEval(uint16_t minPWMAmount = 102, uint16_t maxPWMAmount = 512);
+    constexpr PCA9685_ServoEval(uint16_t minPWMAmount = 102, uint16_t maxPWMAmount = 512)
+        : PCA9685_ServoEval(ConstrainedTag(),
+                            constrainPWM(minPWMAmount, 0),
+                            constrainPWM(maxPWMAmount, constrainPWM(minPWMAmount, 0)))
+    { }
 
     // Uses a cubic spline to interpolate due to an offsetted zero point that isn't
     // exactly between -90/+90 (or -1x/+1x). This takes more time to compute, but gives a
     // smoother PWM output value along the entire range.
-    PCA9685_ServoEval(uint16_t minPWMAmount, uint16_t midPWMAmount, uint16_t maxPWMAmount);
+    constexpr PCA9685_ServoEval(uint16_t minPWMAmount, uint16_t midPWMAmount, uint16_t maxPWMAmount)
+        : PCA9685_ServoEval(ConstrainedTag(),
+                            constrainPWM(minPWMAmount, 0),
+                            constrainPWM(midPWMAmount, constrainPWM(minPWMAmount, 0)),
+                            constrainPWM(maxPWMAmount, constrainPWM(midPWMAmount, constrainPWM(minPWMAmount, 0))))
+    { }
+
+    // Uses a cubic spline to interpolate between NumPoints calibration points, evenly
+    // spaced from -90 to +90 (or -1x/+1x), e.g. 5 points for -90/-45/0/+45/+90. Useful
+    // for servos whose response is too nonlinear to be described by 3 points alone.
+    // NumPoints must be between 2 and PCA9685_SERVOEVAL_MAX_POINTS.
+    template<int NumPoints>
+    PCA9685_ServoEval(const uint16_t (&pwmAmounts)[NumPoints])
+        : PCA9685_ServoEval(ConstrainedTag(), 0, 0)
+    {
+        static_assert(NumPoints >= 2 && NumPoints <= PCA9685_SERVOEVAL_MAX_POINTS, "Unsupported number of calibration points");
+        initCSpline(NULL, pwmAmounts, NumPoints);
+    }
 
-    ~PCA9685_ServoEval();
+    // Uses a cubic spline to interpolate between NumPoints calibration points, at the
+    // given angle offsets (-90 to +90, strictly increasing). Angle offsets outside of the
+    // first/last calibration points are clamped. Segment lookups take slightly longer
+    // than with evenly spaced calibration points (binary search vs. direct indexing).
+    // Angle offsets that aren't strictly increasing (once constrained to -90/+90) fail an
+    // assert, with the evaluator otherwise always returning 0 (full off).
+    template<int NumPoints>
+    PCA9685_ServoEval(const float (&angles)[NumPoints], const uint16_t (&pwmAmounts)[NumPoints])
+        : PCA9685_ServoEval(ConstrainedTag(), 0, 0)
+    {
+        static_assert(NumPoints >= 2 && NumPoints <= PCA9685_SERVOEVAL_MAX_POINTS, "Unsupported number of calibration points");
+        initCSpline(angles, pwmAmounts, NumPoints);
+    }
 
     // Returns the PWM value to use given the angle offset (-90 to +90)
-    uint16_t pwmForAngle(float angle);
+    uint16_t pwmForAngle(float angle) const;
 
     // Returns the PWM value to use given the speed multiplier (-1 to +1)
-    uint16_t pwmForSpeed(float speed);
+    uint16_t pwmForSpeed(float speed) const;
+
+    // Fixed-point variants that use only integer math, useful on processors without an
+    // FPU (e.g. 8-bit AVR). Angle offset is in Q8 format (-90 << 8 to +90 << 8, i.e.
+    // 1/256th of a degree) and speed multiplier is in Q8 format (-256 to +256). Results
+    // may differ from the floating-point variants by a PWM step or so due to rounding.
+    uint16_t pwmForAngleQ8(int16_t angleQ8) const;
+    uint16_t pwmForSpeedQ8(int16_t speedQ8) const;
+
+    // Batch variants that convert numAngles angle offsets at once, with output directly
+    // consumable by PCA9685::setChannelsPWM(). See PCA9685_ServoEvalTable for batches
+    // with per-channel calibrations.
+    void pwmForAngles(const float *angles, uint16_t *pwmAmounts, int numAngles) const;
+    void pwmForAngles(const int16_t *anglesQ8, uint16_t *pwmAmounts, int numAngles) const;
+
+    // Returns the angle offset (-90 to +90) that the given PWM value corresponds to, as
+    // the inverse of pwmForAngle(). Cubic spline segments are solved using a bounded
+    // number of Newton steps. Useful along with PCA9685::getChannelsPWM() to recover
+    // servo positions from device registers (e.g. after a restart) without re-homing.
+    float angleForPwm(uint16_t pwmAmount) const;
+
+    // Returns the speed multiplier (-1 to +1) that the given PWM value corresponds to
+    float speedForPwm(uint16_t pwmAmount) const;
 
 private:
-    float *_coeff;      // a,b,c,d coefficient values
-    bool _isCSpline;    // Cubic spline tracking, for _coeff length
+    template<int NumServos> friend class PCA9685_ServoEvalTable;
+
+    struct ConstrainedTag { };
+
+    // Linear coefficients, over entire -90/+90 range
+    struct Linear {
+        float coeff[2];                                                 // a,b coefficient values
+        int32_t coeffQ[2];                                              // A,B fixed-point coefficient values (Q4, normalized over range)
+    };
+
+    // Cubic spline coefficients and segments
+    struct CSpline {
+        float coeff[(PCA9685_SERVOEVAL_MAX_POINTS - 1) * 4];            // a,b,c,d coefficient values, per segment
+        int32_t coeffQ[(PCA9685_SERVOEVAL_MAX_POINTS - 1) * 4];         // A,B,C,D fixed-point coefficient values (Q4, normalized over segment), per segment
+        uint16_t knotsQ8[PCA9685_SERVOEVAL_MAX_POINTS];                 // Segment begin/end angles (Q8, 0 to 180 << 8)
+        uint32_t tScales[PCA9685_SERVOEVAL_MAX_POINTS - 1];             // Fixed-point segment position scalers, per segment
+    };
+
+    union Coefficients {
+        Linear linear;
+        CSpline cspline;
+
+        constexpr Coefficients() : linear() { }
+        constexpr Coefficients(const Linear& linearCoeffs) : linear(linearCoeffs) { }
+        constexpr Coefficients(const CSpline& csplineCoeffs) : cspline(csplineCoeffs) { }
+    };
+
+    Coefficients _coeffs;       // Coefficient values, per _isCSpline
+    uint32_t _segmentScale;     // Fixed-point segment index scaler (Q24), for evenly spaced segments
+    byte _numSegments;          // Number of segments in use
+    bool _isCSpline;            // Cubic spline tracking, for _coeffs member
+    bool _isUniform;            // Evenly spaced segments tracking, for segment lookups
+
+    constexpr PCA9685_ServoEval(ConstrainedTag, uint16_t minPWMAmount, uint16_t maxPWMAmount)
+        : _coeffs(linearCoeffs(minPWMAmount, maxPWMAmount)),
+          _segmentScale(0), _numSegments(1), _isCSpline(false), _isUniform(true)
+    { }
+
+    constexpr PCA9685_ServoEval(ConstrainedTag, uint16_t minPWMAmount, uint16_t midPWMAmount, uint16_t maxPWMAmount)
+        : _coeffs(maxPWMAmount - midPWMAmount != midPWMAmount - minPWMAmount
+                  ? Coefficients(csplineCoeffs(minPWMAmount, midPWMAmount, maxPWMAmount, (maxPWMAmount - 2.0f * midPWMAmount + minPWMAmount) / 10800.0f))
+                  : Coefficients(linearCoeffs(minPWMAmount, maxPWMAmount))),
+          _segmentScale(maxPWMAmount - midPWMAmount != midPWMAmount - minPWMAmount ? (2UL << 24) / (180UL << 8) : 0),
+          _numSegments(maxPWMAmount - midPWMAmount != midPWMAmount - minPWMAmount ? 2 : 1),
+          _isCSpline(maxPWMAmount - midPWMAmount != midPWMAmount - minPWMAmount),
+          _isUniform(true)
+    { }
+
+    static constexpr uint16_t constrainPWM(uint16_t pwmAmount, uint16_t minPWMAmount) {
+        return pwmAmount < minPWMAmount ? minPWMAmount : (pwmAmount > 4096 ? 4096 : pwmAmount);
+    }
+
+    static constexpr int32_t roundQ4(float value) {
+        return (int32_t)(value * 16.0f + (value < 0.0f ? -0.5f : 0.5f));
+    }
+
+    static constexpr Linear linearCoeffs(uint16_t minPWMAmount, uint16_t maxPWMAmount) {
+        return Linear{ { (float)minPWMAmount, (maxPWMAmount - minPWMAmount) / 180.0f },
+                       { (int32_t)minPWMAmount << 4, (int32_t)(maxPWMAmount - minPWMAmount) << 4 } };
+    }
+
+    // Closed form of the natural cubic spline through -90/0/+90, with k being the second
+    // segment's c coefficient (and t scalers being (4096 << 16) / (90 << 8), rounded up).
+    static constexpr CSpline csplineCoeffs(float y0, float y1, float y2, float k) {
+        return CSpline{ { y0, ((y1 - y0) / 90.0f) - (30.0f * k), 0.0f, k / 270.0f,
+                          y1, ((y2 - y1) / 90.0f) - (60.0f * k), k, -k / 270.0f },
+                        { roundQ4(y0), roundQ4((y1 - y0) - (2700.0f * k)), 0, roundQ4(2700.0f * k),
+                          roundQ4(y1), roundQ4((y2 - y1) - (5400.0f * k)), roundQ4(8100.0f * k), roundQ4(-2700.0f * k) },
+                        { 0, 90U << 8, 180U << 8 },
+                        { 11651, 11651 } };
+    }
+
+    void initCSpline(const float *angles, const uint16_t *pwmAmounts, int numPoints);
+    int findSegment(uint16_t angleQ8) const;
 };
 
+// Class to assist with calculating Servo PWM values for many servos at once, each with
+// its own calibration. Coefficients are stored in a packed struct-of-arrays layout so
+// that batch evaluation is a tight, branchless loop that compilers can vectorize (e.g.
+// on ARM/x86), in floating-point or in fixed-point for Q8 angles (e.g. on AVR, which
+// lacks a floating-point unit). Uses 64 bytes of RAM per servo.
+template<int NumServos = 16>
+class PCA9685_ServoEvalTable {
+public:
+    PCA9685_ServoEvalTable() {
+        for (int index = 0; index < NumServos; ++index) {
+            setServo(index, 102, 512);
+        }
+    }
+
+    // Copies calibration of given servo evaluator into servo slot. Only linear and 3
+    // point (-90/0/+90) cubic spline servo evaluators are supported, returning false
+    // otherwise.
+    bool setServo(int index, const PCA9685_ServoEval& servoEval) {
+        if (index < 0 || index >= NumServos) return false;
+
+        if (!servoEval._isCSpline) {
+            setLinear(index, servoEval._coeffs.linear.coeff[0], servoEval._coeffs.linear.coeff[1],
+                      servoEval._coeffs.linear.coeffQ[0], servoEval._coeffs.linear.coeffQ[1]);
+        }
+        else {
+            if (servoEval._numSegments != 2 || !servoEval._isUniform) return false;
+
+            for (int segment = 0; segment < 2; ++segment) {
+                _a[segment][index] = servoEval._coeffs.cspline.coeff[4 * segment + 0];
+                _b[segment][index] = servoEval._coeffs.cspline.coeff[4 * segment + 1];
+                _c[segment][index] = servoEval._coeffs.cspline.coeff[4 * segment + 2];
+                _d[segment][index] = servoEval._coeffs.cspline.coeff[4 * segment + 3];
+                _aQ[segment][index] = servoEval._coeffs.cspline.coeffQ[4 * segment + 0];
+                _bQ[segment][index] = servoEval._coeffs.cspline.coeffQ[4 * segment + 1];
+                _cQ[segment][index] = servoEval._coeffs.cspline.coeffQ[4 * segment + 2];
+                _dQ[segment][index] = servoEval._coeffs.cspline.coeffQ[4 * segment + 3];
+            }
+        }
+        return true;
+    }
+
+    // Sets linear calibration of servo slot. See PCA9685_ServoEval constructor.
+    void setServo(int index, uint16_t minPWMAmount, uint16_t maxPWMAmount) {
+        if (index < 0 || index >= NumServos) return;
+
+        minPWMAmount = minPWMAmount < PCA9685_Detail::PWM_FULL ? minPWMAmount : PCA9685_Detail::PWM_FULL;
+        maxPWMAmount = maxPWMAmount < PCA9685_Detail::PWM_FULL ? maxPWMAmount : PCA9685_Detail::PWM_FULL;
+        setLinear(index, minPWMAmount, (maxPWMAmount - (float)minPWMAmount) / 180.0f,
+                  (int32_t)minPWMAmount << 4, ((int32_t)maxPWMAmount - (int32_t)minPWMAmount) << 4);
+    }
+
+    // Computes PWM values for numAngles servo slots, beginning at servo slot 0, given the
+    // angle offsets (-90 to +90). Output is directly consumable by setChannelsPWM().
+    PCA9685_VECTORIZABLE void pwmForAngles(const float *angles, uint16_t *pwmAmounts, int numAngles) {
+        if (numAngles > NumServos) numAngles = NumServos;
+
+        // Both segments are evaluated and then selected between at the end, rather than
+        // branching on which segment to use, so that the loop remains vectorizable.
+        for (int index = 0; index < numAngles; ++index) {
+            float angle = angles[index] + 90.0f;
+            angle = angle < 0.0f ? 0.0f : angle;
+            angle = angle > 180.0f ? 180.0f : angle;
+
+            float lowerAngle = angle;
+            float lowerVal = _d[0][index];
+            lowerVal = _c[0][index] + (lowerVal * lowerAngle);
+            lowerVal = _b[0][index] + (lowerVal * lowerAngle);
+            lowerVal = _a[0][index] + (lowerVal * lowerAngle);
+
+            float upperAngle = angle - 90.0f;
+            float upperVal = _d[1][index];
+            upperVal = _c[1][index] + (upperVal * upperAngle);
+            upperVal = _b[1][index] + (upperVal * upperAngle);
+            upperVal = _a[1][index] + (upperVal * upperAngle);
+
+            float retVal = upperAngle > 0.0f ? upperVal : lowerVal;
+            retVal = retVal < 0.0f ? 0.0f : retVal;
+            retVal = retVal > 4096.0f ? 4096.0f : retVal;
+            pwmAmounts[index] = (uint16_t)(int32_t)(retVal + 0.5f);
+        }
+    }
+
+    // Computes PWM values for numAngles servo slots given angle offsets in Q8 format
+    // (-90 << 8 to +90 << 8), using only integer math. See PCA9685_ServoEval::pwmForAngleQ8.
+    void pwmForAngles(const int16_t *anglesQ8, uint16_t *pwmAmounts, int numAngles) {
+        if (numAngles > NumServos) numAngles = NumServos;
+
+        // Same as above, with segment position t in Q12 (0 to 4096 over each 90 degrees,
+        // with scaler being (4096 << 16) / (90 << 8), rounded up) and coefficients in Q4.
+        for (int index = 0; index < numAngles; ++index) {
+            int32_t angle = (int32_t)anglesQ8[index] + (90L << 8);
+            angle = angle < 0 ? 0 : angle;
+            angle = angle > (180L << 8) ? (180L << 8) : angle;
+
+            int32_t lowerT = (int32_t)(((uint32_t)angle * 11651UL) >> 16);
+            int32_t lowerValQ4 = _dQ[0][index];
+            lowerValQ4 = _cQ[0][index] + ((lowerValQ4 * lowerT) >> 12);
+            lowerValQ4 = _bQ[0][index] + ((lowerValQ4 * lowerT) >> 12);
+            lowerValQ4 = _aQ[0][index] + ((lowerValQ4 * lowerT) >> 12);
+
+            int32_t upperAngle = angle - (90L << 8);
+            int32_t upperT = (int32_t)(((uint32_t)(upperAngle > 0 ? upperAngle : 0) * 11651UL) >> 16);
+            int32_t upperValQ4 = _dQ[1][index];
+            upperValQ4 = _cQ[1][index] + ((upperValQ4 * upperT) >> 12);
+            upperValQ4 = _bQ[1][index] + ((upperValQ4 * upperT) >> 12);
+            upperValQ4 = _aQ[1][index] + ((upperValQ4 * upperT) >> 12);
+
+            int32_t retVal = ((upperAngle > 0 ? upperValQ4 : lowerValQ4) + 8) >> 4;
+            retVal = retVal < 0 ? 0 : retVal;
+            retVal = retVal > (int32_t)PCA9685_Detail::PWM_FULL ? (int32_t)PCA9685_Detail::PWM_FULL : retVal;
+            pwmAmounts[index] = (uint16_t)retVal;
+        }
+    }
+
+private:
+    float _a[2][NumServos];     // a coefficients, per segment (-90 to 0, 0 to +90)
+    float _b[2][NumServos];     // b coefficients, per segment
+    float _c[2][NumServos];     // c coefficients, per segment
+    float _d[2][NumServos];     // d coefficients, per segment
+    int32_t _aQ[2][NumServos];  // A fixed-point coefficients (Q4, normalized over segment), per segment
+    int32_t _bQ[2][NumServos];  // B fixed-point coefficients, per segment
+    int32_t _cQ[2][NumServos];  // C fixed-point coefficients, per segment
+    int32_t _dQ[2][NumServos];  // D fixed-point coefficients, per segment
+
+    void setLinear(int index, float minPWMAmount, float slope, int32_t minPWMAmountQ4, int32_t rangeQ4) {
+        // Linear is expressed as two segments so that the evaluation loops stay uniform,
+        // with fixed-point range being over all 180 degrees, and so halved per segment.
+        _a[0][index] = minPWMAmount;
+        _a[1][index] = minPWMAmount + (slope * 90.0f);
+        _b[0][index] = _b[1][index] = slope;
+        _c[0][index] = _c[1][index] = 0.0f;
+        _d[0][index] = _d[1][index] = 0.0f;
+        _aQ[0][index] = minPWMAmountQ4;
+        _aQ[1][index] = minPWMAmountQ4 + (rangeQ4 / 2);
+        _bQ[0][index] = _bQ[1][index] = rangeQ4 / 2;
+        _cQ[0][index] = _cQ[1][index] = 0;
+        _dQ[0][index] = _dQ[1][index] = 0;
+    }
+};
+
+// Shared lookup logic for servo evaluator lookup tables, see below. Step size is in Q8
+// format (1/256th of a degree), and must evenly divide the -90/+90 range.
+template<uint16_t StepQ8>
+class PCA9685_ServoEvalLUTBase {
+public:
+    enum { TableSize = ((180U << 8) / StepQ8) + 1 };
+
+    // Returns the PWM value to use given the angle offset (-90 to +90)
+    uint16_t pwmForAngle(float angle) const {
+        return pwmForAngleQ8((int16_t)roundf(constrain(angle, -90.0f, 90.0f) * 256.0f));
+    }
+
+    // Returns the PWM value to use given the speed multiplier (-1 to +1)
+    uint16_t pwmForSpeed(float speed) const {
+        return pwmForAngle(speed * 90.0f);
+    }
+
+    // Returns the PWM value to use given the angle offset in Q8 format (-90 << 8 to +90 << 8)
+    uint16_t pwmForAngleQ8(int16_t angleQ8) const {
+        uint16_t angle = (uint16_t)(constrain((int32_t)angleQ8, -(90L << 8), 90L << 8) + (90L << 8)); // 0 to 180 << 8
+        uint16_t index = angle / StepQ8;
+        uint16_t remainder = angle % StepQ8;
+
+        uint16_t retVal = readTable(index);
+        if (_interpolate && remainder) {
+            int32_t delta = (int32_t)readTable(index + 1) - (int32_t)retVal;
+            retVal += (int16_t)((delta * remainder) / (int32_t)StepQ8);
+        }
+        return retVal;
+    }
+
+    // Returns the PWM value to use given the speed multiplier in Q8 format (-256 to +256)
+    uint16_t pwmForSpeedQ8(int16_t speedQ8) const {
+        return pwmForAngleQ8((int16_t)constrain((int32_t)speedQ8 * 90, -(90L << 8), 90L << 8));
+    }
+
+protected:
+    const uint16_t *_table;     // Table of TableSize PWM values, from -90 to +90
+    bool _inProgmem;            // Table storage tracking, for _table reads
+    bool _interpolate;          // Linear interpolation between table entries
+
+    PCA9685_ServoEvalLUTBase(const uint16_t *table, bool inProgmem, bool interpolate)
+        : _table(table), _inProgmem(inProgmem), _interpolate(interpolate)
+    {
+        static_assert(StepQ8 > 0 && (180U << 8) % StepQ8 == 0, "Step size must evenly divide the -90/+90 range");
+    }
+
+    uint16_t readTable(uint16_t index) const {
+#ifdef pgm_read_word
+        if (_inProgmem) return pgm_read_word(&_table[index]);
+#endif
+        return _table[index];
+    }
+};
+
+// Class to assist with calculating Servo PWM values from angle/speed values using a
+// precomputed lookup table, sampled from a servo evaluator at every StepQ8 step (in
+// 1/256th of a degree, e.g. 256 for integer degree steps, 128 for half degree steps,
+// or 1024 for four degree steps). Lookups take constant time, with optional linear
+// interpolation between table entries. Table is stored in RAM, using 2 bytes per entry.
+template<uint16_t StepQ8 = 256>
+class PCA9685_ServoEvalLUT : public PCA9685_ServoEvalLUTBase<StepQ8> {
+public:
+    typedef PCA9685_ServoEvalLUTBase<StepQ8> Base;
+
+    // Samples given servo evaluator over the entire -90/+90 (or -1x/+1x) range.
+    PCA9685_ServoEvalLUT(const PCA9685_ServoEval& servoEval, bool interpolate = true)
+        : Base(_tableData, false, interpolate)
+    {
+        for (uint16_t index = 0; index < Base::TableSize; ++index) {
+            _tableData[index] = servoEval.pwmForAngle(((int32_t)index * StepQ8 - (90L << 8)) / 256.0f);
+        }
+    }
+
+    // Copies re-point the base's table pointer at their own table data, not the source's
+    PCA9685_ServoEvalLUT(const PCA9685_ServoEvalLUT& other)
+        : Base(_tableData, false, other._interpolate)
+    {
+        memcpy(_tableData, other._tableData, sizeof(_tableData));
+    }
+    PCA9685_ServoEvalLUT& operator=(const PCA9685_ServoEvalLUT& other) {
+        memcpy(_tableData, other._tableData, sizeof(_tableData));
+        Base::_interpolate = other._interpolate;
+        return *this;
+    }
+
+    // Prints table out as a PROGMEM array declaration, for use with PCA9685_ServoEvalLUT_P.
+    void printTable(Print& output, const char *name = "servoTable") const {
+        output.print("const uint16_t "); output.print(name);
+        output.print("["); output.print((int)Base::TableSize); output.println("] PROGMEM = {");
+        for (uint16_t index = 0; index < Base::TableSize; ++index) {
+            output.print(index % 16 ? " " : "    ");
+            output.print(_tableData[index]);
+            if (index + 1 < Base::TableSize) output.print(",");
+            if (index % 16 == 15 || index + 1 == Base::TableSize) output.println("");
+        }
+        output.println("};");
+    }
+
+private:
+    uint16_t _tableData[Base::TableSize];
+};
+
+// Class to assist with calculating Servo PWM values from angle/speed values using a
+// precomputed lookup table stored in flash (PROGMEM). Table must contain TableSize
+// entries, typically generated via PCA9685_ServoEvalLUT::printTable(). See above.
+template<uint16_t StepQ8 = 256>
+class PCA9685_ServoEvalLUT_P : public PCA9685_ServoEvalLUTBase<StepQ8> {
+public:
+    typedef PCA9685_ServoEvalLUTBase<StepQ8> Base;
+
+    PCA9685_ServoEvalLUT_P(const uint16_t *progmemTable, bool interpolate = true)
+        : Base(progmemTable, true, interpolate)
+    { }
+};
+
+// Class to assist with temporal dithering of channel outputs, giving an effective 16-bit
+// brightness resolution from the 4096/12-bit PWM range. Each channel's 16-bit target
+// value is split into a 12-bit PWM code and a 4-bit remainder, with the remainder being
+// accumulated over successive PWM periods so that adjacent 12-bit codes are alternated
+// between in the correct ratio. Useful for removing visible banding from LEDs that are
+// driven at low brightness levels. Remainders of 1 or 15 repeat only every 16 periods,
+// which is the lowest flicker frequency dithering produces (12.5Hz at 200Hz PWM), so
+// higher PWM frequencies should be used where that becomes visible.
+class PCA9685_Ditherer {
+public:
+    // Ditherer constructor. The supplied controller should already be initialized.
+    PCA9685_Ditherer(PCA9685& pwmController);
+
+    // Target amounts 0 - 65535, 0 full off, 65535 full on (only values of the form
+    // n << 4, and 65535, will produce a static, non-dithered output)
+    void setChannelTarget(int channel, uint16_t targetAmount);
+    void setChannelsTarget(int begChannel, int numChannels, const uint16_t *targetAmounts);
+
+    // Returns target amounts 0 - 65535
+    uint16_t getChannelTarget(int channel);
+
+    // Advances the dithering scheduler by one step, writing out only those channels whose
+    // dithered PWM code has changed since the last update. Should be called once per PWM
+    // period (e.g. every 5ms at 200Hz) to keep the dithered output stable.
+    void update();
+
+    // Forces all channels to be written out on next update (e.g. after device reset)
+    void invalidate();
+
+private:
+    PCA9685 *_pwmController;                                // Controller instance (unowned)
+    uint16_t _targets[16];                                  // 16-bit target values
+    uint16_t _pwmCodes[16];                                 // Last committed 12-bit PWM codes (0xFFFF = unknown)
+    byte _errors[16];                                       // Accumulated 4-bit remainders
+};
+
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+// Class to assist with phase balancing across multiple modules, such as large rigs that
+// share a single power supply. Plans are stored into each module's phase offsets (see
+// setChannelPhaseOffset), taking effect on each channel's next PWM update. Planning only
+// lines up across modules when their PWM counters run in lockstep, which requires the
+// modules to share a clock (see enableExtClockLine) and be started together. Otherwise,
+// spreading still helps on average, but peak profiles can't be relied upon.
+class PCA9685_PhasePlanner {
+public:
+    // Planner constructor. The supplied controllers should already be initialized, and
+    // channels are numbered across modules in the order given (module * 16 + channel).
+    PCA9685_PhasePlanner(PCA9685 **pwmControllers, int numControllers);
+
+    // Spreads phase offsets of every channel evenly across the PWM cycle, regardless of
+    // each channel's PWM amount (e.g. 160 channels gives offsets 25.6 steps apart).
+    void planLinear();
+
+    // Packs each channel's high phase end-to-end after the previous channel's, wrapping
+    // around the PWM cycle, which keeps at most ceil(sum of PWM amounts / 4096) channels
+    // high at once. PWM amounts (numControllers * 16 long) are those expected to be set,
+    // or if left NULL, those last set on each module.
+    void planPacked(const uint16_t *pwmAmounts = NULL);
+
+    // Computes the peak current drawn in each of numBins equal slices of the PWM cycle,
+    // from each module's last set phases and PWM amounts, returning the overall peak.
+    // Channel currents (numControllers * 16 long) give each channel's on-state current in
+    // whatever unit is desired (e.g. mA), or if left NULL, every channel counts as 1. The
+    // per-bin results are optional, and may be left NULL if only the peak is needed.
+    float getCurrentProfile(float *peakCurrents = NULL, int numBins = 64, const float *channelCurrents = NULL);
+
+    // Returns the total number of channels across all modules
+    int getNumChannels();
+
+private:
+    PCA9685 **_pwmControllers;                              // Controller instances (unowned)
+    int _numControllers;                                    // Number of controllers
+
+    float getCurrentAt(uint16_t phasePosition, const float *channelCurrents);
+};
+
+#endif // /ifdef PCA9685_ENABLE_CHANNEL_CACHE
+
+#define PCA9685_FRAME_START                 (byte)0xA5      // Frame start byte
+#define PCA9685_FRAME_MAX_LENGTH            29              // Frame length for 16 channels: 4 header + 24 payload + 1 CRC
+
+// Frame parser status, as returned per byte fed.
+enum PCA9685_FrameStatus {
+    PCA9685_FrameStatus_Incomplete,             // Frame still being received (or waiting on start byte)
+    PCA9685_FrameStatus_Committed,              // Frame received and written out to module
+    PCA9685_FrameStatus_CRCError,               // Frame dropped, CRC mismatch
+    PCA9685_FrameStatus_FormatError,            // Frame dropped, invalid channel range
+    PCA9685_FrameStatus_UnknownDevice,          // Frame dropped, no module with given address
+
+    PCA9685_FrameStatus_Count,                  // Internal use only
+    PCA9685_FrameStatus_Undefined = -1          // Internal use only
+};
+
+// Class to stream channel data into modules from a compact binary frame protocol, such
+// as sent by a PC over USB serial. Frame layout:
+//   start byte (PCA9685_FRAME_START), device address (A5-A0), begin channel (0-15),
+//   channel count (1-16), packed 12-bit PWM values, CRC-8
+// PWM values are packed two per three bytes, little-endian (v0 bits 0-7, v0 bits 8-11 |
+// v1 bits 0-3 << 4, v1 bits 4-11), with an odd final value taking two bytes. As 12 bits
+// can't hold 4096, a value of 4095 is taken as full on. CRC-8 (poly 0x07, init 0x00) runs
+// over every byte after the start byte. Bad frames are dropped, with the parser then
+// looking for the next start byte.
+// Frames are decoded as bytes arrive into a small staging buffer, and only once the CRC
+// checks out are they set with setChannelsPWM. Nothing goes out onto the i2c line while a
+// frame is partially received, so a stalled or corrupted frame never holds the line up.
+class PCA9685_FrameParser {
+public:
+    // Parser constructor. Frames are matched to the supplied controllers by i2c address.
+    PCA9685_FrameParser(PCA9685 **pwmControllers, int numControllers);
+
+    // Feeds next received byte into parser, returning frame status
+    PCA9685_FrameStatus feed(byte data);
+    // Feeds all bytes currently available from input (e.g. Serial), returning number of
+    // frames committed
+    int feed(Stream &input);
+
+    // Returns number of frames committed and dropped since construction
+    uint32_t getFramesCommitted();
+    uint32_t getFramesDropped();
+
+    // Encodes a frame into buffer (at least PCA9685_FRAME_MAX_LENGTH long), returning its
+    // length, or 0 if channel range is invalid. PWM amounts are clamped to 4095/full on.
+    static int encodeFrame(byte *buffer, byte i2cAddress, int begChannel, int numChannels, const uint16_t *pwmAmounts);
+    // Updates CRC-8 (poly 0x07) with given byte
+    static byte updateCRC(byte crc, byte data);
+
+private:
+    PCA9685 **_pwmControllers;                              // Controller instances (unowned)
+    int _numControllers;                                    // Number of controllers
+    PCA9685 *_pwmController;                                // Controller of current frame
+    byte _state;                                            // Parse state
+    byte _crc;                                              // Running CRC
+    byte _begChannel;                                       // Begin channel of current frame
+    byte _numChannels;                                      // Channel count of current frame
+    byte _numValues;                                        // Values decoded so far
+    byte _payloadIndex;                                     // Byte index within current 3 byte value pair
+    uint16_t _nextValue;                                    // Partially decoded value
+    uint16_t _pwmAmounts[16];                               // Staging buffer, set once CRC checks out
+    uint32_t _framesCommitted;                              // Frames committed count
+    uint32_t _framesDropped;                                // Frames dropped count
+
+    PCA9685_FrameStatus endFrame(bool crcValid);
+};
+
+#define PCA9685_DMX_UNIVERSE_LENGTH         512             // Slots per DMX512 universe (excluding start code)
+#define PCA9685_DMX_16BIT                   (byte)0x01      // Patch flag: 16-bit, using slot (coarse) and slot + 1 (fine)
+#define PCA9685_DMX_GAMMA                   (byte)0x02      // Patch flag: gamma 2.2 corrected, rather than linear
+
+// DMX patch table entry, mapping a universe slot onto a module channel.
+struct PCA9685_DMXPatch {
+    uint16_t slot;                                          // Universe slot index (0-511, i.e. DMX address - 1)
+    byte controller;                                        // Controller index, as given to mapper
+    byte channel;                                           // Channel (0-15)
+    byte flags;                                             // PCA9685_DMX_* flags
+};
+
+// Class to map DMX512 universes onto modules, such as stage rigs with many modules on a
+// single i2c line. Each patched slot is converted to a 12-bit PWM amount, 8-bit or 16-bit
+// and linear or gamma corrected (gamma table is kept in PROGMEM), then compared against
+// the previous universe's amount for that patch, so that only changed channels get
+// written. Last amounts are kept in a caller supplied buffer (2 bytes per patch, i.e. 1KB
+// for a fully patched universe), or when PCA9685_ENABLE_CHANNEL_CACHE is defined, may be
+// taken from each module's channel cache instead (which also catches channels set by
+// other means in between updates). Changed channels are written in runs of consecutive
+// channels per module, each run as one auto-incremented write, so patches sorted by
+// controller and channel give the fewest i2c transactions. Channels of a module whose
+// write failed are rewritten on next update. The first update always writes every
+// patched channel, as modules may still be holding amounts from before an MCU restart,
+// and invalidate() should be called after a module reset to do the same.
+// Bus time dominates: a full universe where every channel changes (32 modules) takes
+// around 20ms at 1MHz, which holds DMX's 44Hz (22.7ms) refresh, while at 400kHz it takes
+// around 50ms, which only holds 44Hz when under around 45% of channels change per frame.
+class PCA9685_DMXMapper {
+public:
+    // Mapper constructor. The supplied controllers should already be initialized. Patch
+    // table is unowned, and may be stored in flash (PROGMEM) if patchesInProgmem is set.
+    // Last amounts buffer is unowned, and should be numPatches long.
+    PCA9685_DMXMapper(PCA9685 **pwmControllers, int numControllers, const PCA9685_DMXPatch *patches, int numPatches, uint16_t *lastAmounts, bool patchesInProgmem = false);
+#ifdef PCA9685_ENABLE_CHANNEL_CACHE
+    // Mapper constructor comparing against controllers' channel caches rather than a last
+    // amounts buffer. See main constructor.
+    PCA9685_DMXMapper(PCA9685 **pwmControllers, int numControllers, const PCA9685_DMXPatch *patches, int numPatches, bool patchesInProgmem = false);
+#endif
+
+    // Converts universe (universeLength slots long, not including start code) and writes
+    // out all changed channels, returning number of channels written. Patches referencing
+    // slots past universeLength are skipped (e.g. for shorter DMX frames).
+    int update(const byte *universe, int universeLength = PCA9685_DMX_UNIVERSE_LENGTH);
+
+    // Forces every patched channel to be written out on next update
+    void invalidate();
+
+    // Returns the PWM amount (0 to 4096) for given slot level, 8-bit (0-255) or 16-bit
+    // (0-65535) as per PCA9685_DMX_* flags
+    static uint16_t pwmForLevel(uint16_t level, byte flags);
+
+private:
+    PCA9685 **_pwmControllers;                              // Controller instances (unowned)
+    int _numControllers;                                    // Number of controllers
+    const PCA9685_DMXPatch *_patches;                       // Patch table (unowned)
+    int _numPatches;                                        // Number of patches
+    uint16_t *_lastAmounts;                                 // Last written PWM amount per patch (unowned), or NULL if using channel caches
+    bool _patchesInProgmem;                                 // Patch table storage tracking, for _patches reads
+    bool _firstUpdate;                                      // First update tracking, for invalidating last amounts
+
+    void readPatch(int index, PCA9685_DMXPatch *patch);
+    int flushChannels(int controller, int begIndex, int endIndex, uint16_t patchedChannels, uint16_t changedChannels, const uint16_t *pwmAmounts);
+};
+
+#ifdef PCA9685_USE_FRAME_BUFFER_SERVICE
+
+#define PCA9685_FRAME_BUFFER_NAME           "/pca9685"      // Default shared memory object name
+#define PCA9685_FRAME_BUFFER_MAGIC          0x35384350UL    // Frame buffer header magic ("PC85")
+#define PCA9685_FRAME_BUFFER_VERSION        2               // Frame buffer layout version
+#define PCA9685_FRAME_BUFFER_MODE           0660            // Default frame buffer permission mode
+
+// Frame buffer slab, one per module, shared between processes. Writers take the seqlock
+// by moving sequence from even to odd, store PWM amounts and mark them in dirtyChannels,
+// then release it by moving sequence on to the next even value. Readers retry until they
+// see the same even sequence before and after reading, up to a bounded number of times,
+// with the service skipping a slab for that frame (keeping it dirty) if sequence stays odd.
+struct PCA9685_FrameBufferSlab {
+    uint32_t sequence;                                      // Seqlock sequence, odd while being written
+    uint16_t dirtyChannels;                                 // Channels written since last flush, as bitmask
+    byte i2cAddress;                                        // Module's i2c address
+    byte reserved;                                          // Reserved, keeps pwmAmounts aligned
+    uint16_t pwmAmounts[16];                                // Channel PWM amounts (0 to 4096)
+};
+
+// Frame buffer header, followed by numSlabs slabs.
+struct PCA9685_FrameBufferHeader {
+    uint32_t magic;                                         // PCA9685_FRAME_BUFFER_MAGIC
+    uint16_t version;                                       // PCA9685_FRAME_BUFFER_VERSION
+    uint16_t numSlabs;                                      // Number of slabs following header
+    uint32_t framesFlushed;                                 // Number of flushes run by service
+    uint32_t ownerPid;                                      // Service's process id, for detecting stale frame buffers
+};
+
+// Class to let other processes on a Linux host set channels through a frame buffer held
+// in POSIX shared memory, without any of them needing to open the i2c line. Setting
+// channels only stores into the frame buffer (no system calls), and the service's bus
+// thread then flushes dirty channels out at a fixed frame rate, skipping channels whose
+// PWM amount hasn't changed (when PCA9685_ENABLE_CHANNEL_CACHE is defined) and writing
+// runs of consecutive channels as one auto-incremented write each. Once begun, only the
+// bus thread may use the given controllers, as the library itself isn't thread-safe.
+class PCA9685_FrameBufferService {
+public:
+    // Service constructor. The supplied controllers should already be initialized, and
+    // their last set PWM amounts (read back from modules on begin if there's no channel
+    // cache) become the frame buffer's initial contents.
+    PCA9685_FrameBufferService(PCA9685 **pwmControllers, int numControllers);
+    ~PCA9685_FrameBufferService();
+
+    // Creates shared memory frame buffer with given permission mode and starts bus thread
+    // flushing at frameRate (in Hz), returning false on failure. A frame buffer of the same
+    // name is only replaced if its service process is no longer running, so that a second
+    // service fails to begin rather than taking over the name. Clients need read and write
+    // access, i.e. the same user or (with the default mode) group. If frameRate is 0, no
+    // bus thread is started, and flush() must instead be called.
+    bool begin(float frameRate = 100, const char *name = PCA9685_FRAME_BUFFER_NAME, mode_t mode = PCA9685_FRAME_BUFFER_MODE);
+    // Stops bus thread, and removes shared memory frame buffer
+    void end();
+
+    // Sets bus thread's frame rate (in Hz), taking effect from next frame
+    void setFrameRate(float frameRate);
+
+    // Flushes dirty channels out to modules, returning number of channels written
+    int flush();
+
+    // Returns number of flushes run, and number of frames where flushing overran the
+    // frame period (i.e. bus can't keep up with frame rate)
+    uint32_t getFramesFlushed();
+    uint32_t getFrameOverruns();
+
+private:
+    PCA9685 **_pwmControllers;                              // Controller instances (unowned)
+    int _numControllers;                                    // Number of controllers
+    char _name[32];                                         // Shared memory object name
+    PCA9685_FrameBufferHeader *_header;                     // Mapped frame buffer, or NULL if not begun
+    size_t _mappedLength;                                   // Mapped frame buffer length, in bytes
+    pthread_t _busThread;                                   // Bus thread
+    bool _busThreadRunning;                                 // Bus thread started flag
+    bool _stopping;                                         // Bus thread stop request flag
+    uint32_t _framePeriodNanos;                             // Frame period, in nanoseconds
+    uint32_t _frameOverruns;                                // Frame overrun count
+
+    static void *busThreadMain(void *service);
+};
+
+// Class to set channels through a PCA9685_FrameBufferService's frame buffer, from any
+// process on the same host. Modules are referenced by slab index, in the same order as
+// the service's controllers (see getSlabIndex to look up by i2c address). Writers spin
+// while another writer holds a slab's seqlock, so a process should not be killed while
+// mid-write.
+class PCA9685_FrameBufferClient {
+public:
+    PCA9685_FrameBufferClient();
+    ~PCA9685_FrameBufferClient();
+
+    // Attaches to a service's frame buffer, returning false if not found or incompatible
+    bool attach(const char *name = PCA9685_FRAME_BUFFER_NAME);
+    // Detaches from frame buffer
+    void detach();
+
+    // Returns number of slabs (modules) in frame buffer, or 0 if not attached
+    int getNumSlabs();
+    // Returns slab index of module with given i2c address, or -1 if not found
+    int getSlabIndex(byte i2cAddress);
+
+    // Sets channel PWM amount(s) (0 to 4096) of given slab's module
+    void setChannelPWM(int slab, int channel, uint16_t pwmAmount);
+    void setChannelsPWM(int slab, int begChannel, int numChannels, const uint16_t *pwmAmounts);
+
+    // Gets channel PWM amount(s) last set in frame buffer (not read from module). Slabs
+    // left mid-write for too long (e.g. by a killed process) fail to read, giving 0 or false.
+    uint16_t getChannelPWM(int slab, int channel);
+    bool getChannelsPWM(int slab, int begChannel, int numChannels, uint16_t *pwmAmounts);
+
+private:
+    PCA9685_FrameBufferHeader *_header;                     // Mapped frame buffer, or NULL if not attached
+    size_t _mappedLength;                                   // Mapped frame buffer length, in bytes
+
+    PCA9685_FrameBufferSlab *getSlab(int slab);
+};
+
+#endif // /ifdef PCA9685_USE_FRAME_BUFFER_SERVICE
+
+#ifdef PCA9685_ENABLE_RECORDER
+
+#define PCA9685_RECORD_MAGIC0               (byte)0x50      // Recording header, first byte ('P')
+#define PCA9685_RECORD_MAGIC1               (byte)0x52      // Recording header, second byte ('R')
+#define PCA9685_RECORD_VERSION              (byte)1         // Recording header, format version
+
+// Channel values last recorded per device, which recordings are delta-encoded against.
+// Recorder and player both track the same devices in the same order, so both agree on
+// deltas. Devices past PCA9685_RECORDER_MAX_DEVICES go untracked, and encode in full.
+class PCA9685_RecordState {
+protected:
+    byte _numDevices;                                       // Number of devices tracked
+    int _device;                                            // Current device index, or -1 if untracked
+    byte _i2cAddress;                                       // Current device i2c address, or 0xFF if none yet
+    byte _deviceAddresses[PCA9685_RECORDER_MAX_DEVICES];    // Tracked device i2c addresses
+    uint16_t _phaseBegins[PCA9685_RECORDER_MAX_DEVICES][16]; // Last channel phase begins per tracked device
+    uint16_t _phaseEnds[PCA9685_RECORDER_MAX_DEVICES][16];  // Last channel phase ends per tracked device
+
+    PCA9685_RecordState();
+
+    void resetState();
+    void selectDevice(byte i2cAddress);
+    uint16_t getLastPhaseBegin(int channel);
+    uint16_t getLastPhaseEnd(int channel);
+    void updateState(int channel, uint16_t phaseBegin, uint16_t phaseEnd);
+};
+
+// Class to record every write made by PCA9685 instances (channel, ALLLED and register
+// writes, and software resets) into a compact delta-compressed format, such as to
+// capture exactly what was sent to modules in the field. Recordings start with a 3 byte
+// header (PCA9685_RECORD_MAGIC0/1, PCA9685_RECORD_VERSION), followed by records of:
+//   tag byte, varint time delta (microseconds since last record, only when tag bit 7 is
+//   set), then payload by record kind (tag bits 5-6):
+//   0 Channel: tag bits 0-3 channel, with tag bit 4 set if phase begin is unchanged,
+//     payload zigzag varint phase begin delta (unless unchanged), zigzag varint delta of
+//     phase end less phase begin, deltas being against device's last recorded values
+//   1 Register: payload register address byte, value byte
+//   2 Device: payload i2c address byte, selecting device for subsequent records
+//   3 Special: tag bits 0-4 subkind, 0 ALLLED write (payload varint phase begin, varint
+//     phase end), 1 software reset (no payload)
+// A typical channel write records in 2-3 bytes. Varints are little-endian base 128. Time
+// deltas are from micros(), so gaps between writes must stay under ~71 minutes. Only
+// writes that went through get recorded, with each transaction taking a single timestamp.
+class PCA9685_Recorder : protected PCA9685_RecordState {
+public:
+    PCA9685_Recorder();
+    ~PCA9685_Recorder();
+
+    // Begins recording into output (e.g. a PCA9685_RecordBuffer, an SD card File, or
+    // Serial), replacing any other active recorder. Recording ends by itself upon the
+    // first short write (e.g. once buffer is full), leaving what was recorded playable.
+    void begin(Print &output);
+    // Ends recording
+    void end();
+
+    // Returns if recording is active
+    bool isRecording();
+    // Returns number of bytes recorded
+    uint32_t getBytesRecorded();
+
+private:
+    // Channel write held until its transaction ends
+    struct PendingChannel {
+        byte i2cAddress;                                    // Module's i2c address
+        byte regAddress;                                    // Channel register address
+        uint16_t phaseBegin;                                // Phase begin written
+        uint16_t phaseEnd;                                  // Phase end written
+    };
+
+    Print *_output;                                         // Recording output (unowned), or NULL if not recording
+    uint32_t _lastMicros;                                   // micros() at last record
+    uint32_t _recordMicros;                                 // micros() at current record(s), shared per transaction
+    uint32_t _bytesRecorded;                                // Bytes recorded count
+    PendingChannel _pendingChannels[16];                    // Channel writes of current transaction
+    byte _numPendingChannels;                               // Number of pending channel writes
+
+    void recordChannel(byte i2cAddress, byte regAddress, uint16_t phaseBegin, uint16_t phaseEnd);
+    void commitChannels();
+    void discardChannels();
+    void recordRegister(byte i2cAddress, byte regAddress, byte value);
+    void recordReset();
+    void encodeChannel(byte i2cAddress, byte regAddress, uint16_t phaseBegin, uint16_t phaseEnd);
+    byte *encodeTag(byte *out, byte tag);
+    byte *encodeDevice(byte *out, byte i2cAddress);
+    void emit(const byte *buffer, int length);
+
+    friend class PCA9685;
+};
+
+// Class to play back recordings made by PCA9685_Recorder against modules, at original or
+// accelerated speed. Records are read as they come due, so memory used stays the same
+// however long the recording, and recordings may be played straight off of an SD card
+// File. Devices are matched to the supplied controllers by i2c address, with records for
+// other devices skipped. Consecutive channel writes recorded at the same time are played
+// back as one auto-incremented write, as originally sent. Accelerated playback shortens
+// all delays, including those the library waits on (e.g. oscillator restart).
+class PCA9685_Player : protected PCA9685_RecordState {
+public:
+    // Player constructor. The supplied controllers should already be initialized.
+    PCA9685_Player(PCA9685 **pwmControllers, int numControllers);
+
+    // Begins playback from input at given speed multiplier (e.g. 1 for original speed, 10
+    // for 10x faster, or 0 for as fast as possible), returning false if input doesn't
+    // start with a valid recording header
+    bool begin(Stream &input, float speed = 1);
+    // Ends playback
+    void end();
+
+    // Plays back all records that have come due, returning false once playback has ended
+    // (e.g. end of recording). Should be called often, such as every loop().
+    bool update();
+
+    // Returns if playback is active
+    bool isPlaying();
+    // Returns number of records played back
+    uint32_t getRecordsPlayed();
+
+private:
+    PCA9685 **_pwmControllers;                              // Controller instances (unowned)
+    int _numControllers;                                    // Number of controllers
+    Stream *_input;                                         // Playback input (unowned), or NULL if not playing
+    float _speed;                                           // Speed multiplier
+    uint32_t _dueMicros;                                    // micros() at which pending record is due
+    bool _pending;                                          // Pending record decoded flag
+    bool _timed;                                            // Pending record has time delta flag
+    byte _kind;                                             // Pending record kind
+    byte _index;                                            // Pending record channel or subkind
+    byte _regAddress;                                       // Pending record register or i2c address
+    byte _value;                                            // Pending record register value
+    uint16_t _phaseBegin;                                   // Pending record phase begin
+    uint16_t _phaseEnd;                                     // Pending record phase end
+    PCA9685 *_pwmController;                                // Selected device's controller, or NULL if unknown
+    PCA9685 *_burstController;                              // Controller of open channel write, or NULL if none
+    byte _burstRegAddress;                                  // Register address of next channel in open channel write
+    byte _burstChannels;                                    // Channels written in open channel write
+    uint32_t _recordsPlayed;                                // Records played count
+
+    bool readRecord();
+    bool readByte(byte *data);
+    bool readVarint(uint32_t *value);
+    void playRecord();
+    void endBurst();
+};
+
+// Fixed-size RAM buffer to record into and play back from, as a Stream. Buffer is
+// unowned. Writes that don't fit are refused whole, which ends recording.
+class PCA9685_RecordBuffer : public Stream {
+public:
+    PCA9685_RecordBuffer(byte *buffer, size_t size);
+
+    virtual size_t write(uint8_t data);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual void flush();
+    using Print::write;
+
+    // Rewinds read position back to start, such as before playing back
+    void rewind();
+    // Clears buffer contents
+    void clear();
+
+    // Returns number of bytes held, and buffer size
+    size_t getLength();
+    size_t getSize();
+
+private:
+    byte *_buffer;                                          // Buffer (unowned)
+    size_t _size;                                           // Buffer size, in bytes
+    size_t _length;                                         // Bytes held
+    size_t _readIndex;                                      // Read position
+};
+
+#endif // /ifdef PCA9685_ENABLE_RECORDER
+
+#ifdef PCA9685_ENABLE_BUS_PROFILER
+
+// Class to profile i2c bus utilization, shared by all instances on the same Wire instance.
+// Each transaction is charged its theoretical bus time, computed from its byte count and
+// the instance's i2c clock speed (9 bits per byte plus address byte, START and STOP),
+// alongside the wall time measured blocking on it. Both are kept over a sliding window
+// made up of PCA9685_BUS_PROFILER_WINDOWS sub-windows, with theoretical bus time also
+// kept by device address (past PCA9685_BUS_PROFILER_MAX_DEVICES addresses, the rest are
+// charged to address 0xFF). Clock stretching, arbitration, and other bus masters' traffic
+// don't show up in theoretical bus time, but may show up in measured wall time.
+class PCA9685_BusProfiler {
+public:
+#ifndef PCA9685_USE_SOFTWARE_I2C
+    // Returns profiler of given Wire instance, or NULL if no transaction has been seen on it
+    static PCA9685_BusProfiler *getProfiler(TwoWire &i2cWire = Wire);
+#else
+    // Returns profiler of software i2c line, or NULL if no transaction has been seen yet
+    static PCA9685_BusProfiler *getProfiler();
+#endif
+
+    // Sets length of each sub-window (default: 250000us, giving a 1s sliding window), which
+    // also clears out all profilers.
+    static void setWindowLength(uint32_t windowMicros);
+
+    // Returns span of sliding window, in microseconds, which grows to its full length
+    // once profiling has been running long enough
+    uint32_t getWindowMicros();
+    // Returns theoretical bus time over sliding window, in microseconds
+    uint32_t getBusMicros();
+    // Returns wall time spent blocking on transactions over sliding window, in microseconds
+    uint32_t getBlockedMicros();
+
+    // Returns theoretical bus time as fraction 0 - 1 of sliding window
+    float getUtilization();
+    // Returns measured wall time as fraction 0 - 1 of sliding window
+    float getBlockedUtilization();
+    // Returns fraction 0 - 1 of sliding window that the bus was left free for
+    float getHeadroom();
+
+    // Returns up to maxConsumers device addresses, heaviest first, along with each one's
+    // theoretical bus time over sliding window in microseconds, returning number written
+    int getTopConsumers(byte *i2cAddresses, uint32_t *busMicros, int maxConsumers);
+
+    void printReport(Print &output = Serial);
+    void reset();
+
+private:
+    const void *_bus;                                       // Bus key, Wire instance (unowned) or NULL if software i2c
+    uint32_t _startMicros;                                  // micros() at begin of profiling
+    uint32_t _windowBegin;                                  // micros() at begin of current sub-window
+    byte _windowIndex;                                      // Current sub-window index
+    byte _numDevices;                                       // Number of device addresses tracked
+    uint32_t _busTimesQ4[PCA9685_BUS_PROFILER_WINDOWS];     // Theoretical bus time per sub-window, in 1/16th microseconds
+    uint32_t _blockedMicros[PCA9685_BUS_PROFILER_WINDOWS];  // Measured wall time per sub-window, in microseconds
+    byte _deviceAddresses[PCA9685_BUS_PROFILER_MAX_DEVICES]; // Tracked device addresses
+    uint32_t _deviceTimesQ4[PCA9685_BUS_PROFILER_MAX_DEVICES][PCA9685_BUS_PROFILER_WINDOWS]; // Theoretical bus time per device per sub-window, in 1/16th microseconds
+
+    static PCA9685_BusProfiler _profilers[PCA9685_BUS_PROFILER_MAX_BUSES]; // Profilers (shared)
+    static byte _numProfilers;                              // Number of profilers in use
+    static uint32_t _windowMicros;                          // Sub-window length, in microseconds
+
+    static PCA9685_BusProfiler *getProfiler(const void *bus, bool create);
+    static void record(const void *bus, byte i2cAddress, uint16_t numBytes, uint32_t i2cSpeed, uint32_t blockedMicros);
+    void slideWindow();
+    uint32_t getDeviceTimeQ4(int device);
+
+    friend class PCA9685;
+};
+
+#endif // /ifdef PCA9685_ENABLE_BUS_PROFILER
+
 #endif // /ifndef PCA9685_H